@@ -0,0 +1,210 @@
+// Headless timings of the collision box test, the bounding box calculation and the vertex
+// generators of every primitive, written as JSON so runs can be compared between releases.
+// Usage: GeometryBenchmark [output.json] [seconds per case], the JSON goes to stdout without a file.
+#include "../src/BoundingBox.cpp"
+#include "../src/Primitives/Sphere.cpp"
+#include "../src/Primitives/Circle.cpp"
+#include "../src/Primitives/Quad.cpp"
+#include "../src/Primitives/Triangle.cpp"
+#include "../src/Primitives/Cuboid.cpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchmarkResult {
+	std::string name;
+	std::string params; // JSON object
+	long long iterations;
+	double nsPerOp;
+	double itemsPerOp; // boxes tested, vertices generated, ... by one operation
+};
+
+static double minSeconds = 0.25;
+static std::vector<BenchmarkResult> results;
+
+// Runs op until minSeconds have passed, doubling the batch so the clock is read rarely
+template <typename Op>
+static void run(const std::string& name, const std::string& params, double itemsPerOp, Op op) {
+	long long iterations = 0, batch = 1;
+	std::chrono::duration<double> elapsed(0.0);
+	auto start = std::chrono::steady_clock::now();
+
+	while (elapsed.count() < minSeconds) {
+		for (long long i = 0; i < batch; i++) {
+			op();
+		}
+		iterations += batch;
+		batch *= 2;
+		elapsed = std::chrono::steady_clock::now() - start;
+	}
+
+	results.push_back({ name, params, iterations, elapsed.count() * 1e9 / iterations, itemsPerOp });
+	std::fprintf(stderr, "%-28s %-36s %14.1f ns/op\n", name.c_str(), params.c_str(), results.back().nsPerOp);
+}
+
+// Keeps the optimizer from dropping results nobody reads
+static volatile size_t sink;
+
+static BoundingBox randomBox(std::mt19937& rng, float worldSize) {
+	std::uniform_real_distribution<float> position(-worldSize, worldSize);
+	std::uniform_real_distribution<float> size(0.2f, 2.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.283f);
+
+	glm::vec3 half(size(rng), size(rng), size(rng));
+	BoundingBox box(std::vector<float>(24, 0.0f), -half, half);
+
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(position(rng), position(rng), position(rng)));
+	model = glm::rotate(model, angle(rng), glm::vec3(1, 0, 0));
+	model = glm::rotate(model, angle(rng), glm::vec3(0, 1, 0));
+	box.setTransformation(model);
+	return box;
+}
+
+static std::string param(const char* key, long long value) {
+	return "{\"" + std::string(key) + "\": " + std::to_string(value) + "}";
+}
+
+static void benchmarkBoxTest(const std::vector<int>& sceneSizes) {
+	for (int count : sceneSizes) {
+		std::mt19937 rng(42);
+		float worldSize = 0.5f * std::cbrt((float)count);
+		std::vector<BoundingBox> boxes;
+		for (int i = 0; i < count; i++) {
+			boxes.push_back(randomBox(rng, worldSize));
+		}
+		BoundingBox camera = randomBox(rng, 0.0f);
+
+		// the camera's box against the whole scene, as the collision test did before the broadphase
+		run("isIntersectingOtherBB", param("objects", count), count, [&]() {
+			size_t hits = 0;
+			for (const BoundingBox& box : boxes) {
+				hits += camera.isIntersectingOtherBB(box, glm::vec3(0.01f, 0.0f, 0.0f));
+			}
+			sink = hits;
+		});
+	}
+}
+
+static const Shader NO_SHADER;
+
+static void benchmarkBounds(const std::vector<int>& steps) {
+	for (int step : steps) {
+		Sphere sphere(NO_SHADER, NO_SHADER, glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(0.0f), glm::vec3(0.0f), 1.0f, step, glm::vec3(1.0f), true);
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		sphere.getVertices(vertices, indices);
+
+		run("calculateBoundingBox", param("steps", step), vertices.size() / 8, [&]() {
+			sphere.calculateBoundingBox(vertices, 8);
+			sink = (size_t)sphere.localBB.halfExtents.x;
+		});
+	}
+}
+
+static void benchmarkGenerators(const std::vector<int>& steps) {
+	glm::vec3 zero(0.0f), one(1.0f);
+
+	for (int step : steps) {
+		Sphere sphere(NO_SHADER, NO_SHADER, zero, one, zero, zero, 1.0f, step, one, true);
+		Circle circle(NO_SHADER, NO_SHADER, zero, one, zero, glm::vec2(0.0f), 1.0f, step, one, true);
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+
+		sphere.getVertices(vertices, indices);
+		run("Sphere::getVertices", param("steps", step), vertices.size() / 8, [&]() {
+			std::vector<float> v;
+			std::vector<unsigned int> i;
+			sphere.getVertices(v, i);
+			sink = v.size() + i.size();
+		});
+
+		vertices.clear();
+		indices.clear();
+		circle.getVertices(vertices, indices);
+		run("Circle::getVertices", param("steps", step), vertices.size() / 8, [&]() {
+			std::vector<float> v;
+			std::vector<unsigned int> i;
+			circle.getVertices(v, i);
+			sink = v.size() + i.size();
+		});
+	}
+
+	// the flat shapes and the cuboid have a fixed vertex count
+	Quad quad(NO_SHADER, NO_SHADER, zero, one, zero, glm::vec2(0.0f), glm::vec2(1.0f), one, true);
+	Triangle triangle(NO_SHADER, NO_SHADER, zero, one, zero, glm::vec2(0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 1.0f), one, true);
+	Cuboid cuboid(NO_SHADER, NO_SHADER, zero, one, zero, zero, one, one, true, nullptr, nullptr);
+
+	run("Quad::getVertices", "{}", quad.getVertices().size() / 8, [&]() { sink = quad.getVertices().size(); });
+	run("Triangle::getVertices", "{}", triangle.getVertices().size() / 8, [&]() { sink = triangle.getVertices().size(); });
+	run("Cuboid::getVertices", "{}", cuboid.getVertices().size() / 8, [&]() { sink = cuboid.getVertices().size(); });
+}
+
+// Generating and bounding a whole scene of mixed primitives, as buildScene does minus the upload
+static void benchmarkScene(const std::vector<int>& sceneSizes) {
+	glm::vec3 zero(0.0f), one(1.0f);
+
+	for (int count : sceneSizes) {
+		run("sceneGeometry", "{\"objects\": " + std::to_string(count) + ", \"steps\": 16}", count, [&]() {
+			size_t built = 0;
+			for (int i = 0; i < count; i++) {
+				switch (i % 5) {
+				case 0: built += Sphere(NO_SHADER, NO_SHADER, zero, one, zero, zero, 1.0f, 16, one, true).localBB.halfExtents.x > 0; break;
+				case 1: built += Circle(NO_SHADER, NO_SHADER, zero, one, zero, glm::vec2(0.0f), 1.0f, 16, one, true).localBB.halfExtents.x > 0; break;
+				case 2: built += Quad(NO_SHADER, NO_SHADER, zero, one, zero, glm::vec2(0.0f), glm::vec2(1.0f), one, true).localBB.halfExtents.x > 0; break;
+				case 3: built += Triangle(NO_SHADER, NO_SHADER, zero, one, zero, glm::vec2(0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 1.0f), one, true).localBB.halfExtents.x > 0; break;
+				case 4: built += Cuboid(NO_SHADER, NO_SHADER, zero, one, zero, zero, one, one, true, nullptr, nullptr).localBB.halfExtents.x > 0; break;
+				}
+			}
+			sink = built;
+		});
+	}
+}
+
+static void writeJSON(FILE* out) {
+	std::fprintf(out, "{\n  \"minSecondsPerCase\": %g,\n  \"benchmarks\": [\n", minSeconds);
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& r = results[i];
+		double opsPerSecond = 1e9 / r.nsPerOp;
+		std::fprintf(out, "    {\"name\": \"%s\", \"params\": %s, \"iterations\": %lld, \"nsPerOp\": %.3f, "
+			"\"opsPerSecond\": %.3f, \"itemsPerOp\": %.0f, \"itemsPerSecond\": %.3f}%s\n",
+			r.name.c_str(), r.params.c_str(), r.iterations, r.nsPerOp,
+			opsPerSecond, r.itemsPerOp, opsPerSecond * r.itemsPerOp, i + 1 < results.size() ? "," : "");
+	}
+	std::fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+	const char* outputPath = argc > 1 ? argv[1] : nullptr;
+	if (argc > 2) {
+		minSeconds = std::atof(argv[2]);
+	}
+
+	// no GL context here, primitives only generate their vertices and bounds
+	Primitive::headless = true;
+
+	const std::vector<int> steps = { 8, 16, 32, 64, 128, 256, 512 };
+	const std::vector<int> sceneSizes = { 10, 100, 1000, 10000, 100000 };
+
+	benchmarkBoxTest(sceneSizes);
+	benchmarkBounds(steps);
+	benchmarkGenerators(steps);
+	benchmarkScene(sceneSizes);
+
+	FILE* out = outputPath != nullptr ? std::fopen(outputPath, "w") : stdout;
+	if (out == nullptr) {
+		std::fprintf(stderr, "ERROR: Could not open %s\n", outputPath);
+		return 1;
+	}
+	writeJSON(out);
+	if (out != stdout) {
+		std::fclose(out);
+	}
+	return 0;
+}
@@ -0,0 +1,115 @@
+// Movers per second of the batched CollisionWorld::isColliding, on pools of 1 up to
+// hardware_concurrency threads, against testing the movers one at a time. Every batched
+// result is checked against the serial one, a mismatch fails the run.
+// Usage: MoverBenchmark [movers]
+#include "../src/Collision/CollisionWorld.cpp"
+#include "../src/Primitives/Sphere.cpp"
+#include "../src/Primitives/Cuboid.cpp"
+#include "../src/ThreadPool.cpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+static const Shader NO_SHADER;
+
+int main(int argc, char** argv) {
+	int moverCount = argc > 1 ? std::atoi(argv[1]) : 10000;
+	const int objectCount = 10000;
+	unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	// no GL context here, the meshes are only kept on the CPU for the narrow phase
+	Primitive::headless = true;
+	Primitive::keepCPUGeometry = true;
+
+	std::mt19937 rng(5);
+	float worldSize = std::cbrt((float)objectCount * 8.0f) * 0.5f;
+	std::uniform_real_distribution<float> position(-worldSize, worldSize);
+	std::uniform_real_distribution<float> size(0.3f, 2.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.283f);
+	std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+	glm::vec3 zero(0.0f), one(1.0f);
+
+	// cuboids and spheres, a third of them unevenly scaled so the narrow phase has work
+	std::vector<Primitive> objects;
+	TransformStore transforms;
+	for (int i = 0; i < objectCount; i++) {
+		glm::vec3 translation(position(rng), position(rng), position(rng));
+		glm::vec3 rotation(angle(rng), angle(rng), angle(rng));
+		glm::vec3 scale = i % 3 == 0 ? glm::vec3(size(rng), size(rng), size(rng)) : glm::vec3(size(rng));
+		if (i % 2 == 0) {
+			objects.push_back(Cuboid(NO_SHADER, NO_SHADER, translation, scale, rotation, zero, one, one, true, nullptr, nullptr));
+		} else {
+			objects.push_back(Sphere(NO_SHADER, NO_SHADER, translation, scale, rotation, zero, 0.5f, 12, one, true));
+		}
+		objects.back().transformId = transforms.add(translation, rotation, scale);
+	}
+	transforms.update();
+
+	std::vector<AABB> bounds;
+	for (Primitive& object : objects) {
+		object.bb = object.localBB.transformed(transforms.world[object.transformId]);
+		bounds.push_back(object.bb.bounds());
+	}
+
+	CollisionWorld world(objects, transforms);
+	world.exactNarrowPhase = true;
+	world.update(bounds, std::vector<unsigned int>());
+
+	// camera sized boxes taking one step each
+	std::vector<MoverQuery> movers;
+	for (int i = 0; i < moverCount; i++) {
+		glm::vec3 center(position(rng), position(rng), position(rng));
+		movers.push_back({ OBB::fromMinMax(center - glm::vec3(0.25f), center + glm::vec3(0.25f)), glm::vec3(step(rng), step(rng), step(rng)) });
+	}
+
+	std::vector<unsigned char> serial(movers.size());
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < movers.size(); i++) {
+		serial[i] = world.isColliding(movers[i].box, movers[i].displacement);
+	}
+	double serialTime = secondsSince(start);
+
+	size_t colliding = std::count(serial.begin(), serial.end(), 1);
+	std::printf("%d objects, %d movers, %zu colliding\n", objectCount, moverCount, colliding);
+	std::printf("%8s %14s %10s\n", "threads", "ns per mover", "speedup");
+	std::printf("%8s %14.1f %10.2f\n", "serial", serialTime / movers.size() * 1e9, 1.0);
+
+	// the one thread pool runs inline, the others have to find the same first objects
+	std::vector<MoverResult> reference;
+	for (unsigned int threads = 1; threads <= maxThreads; threads++) {
+		ThreadPool pool(threads);
+		std::vector<MoverResult> results(movers.size());
+
+		start = std::chrono::steady_clock::now();
+		world.isColliding(movers.data(), movers.size(), results.data(), pool);
+		double batchTime = secondsSince(start);
+
+		if (threads == 1) {
+			reference = results;
+		}
+		for (size_t i = 0; i < movers.size(); i++) {
+			if (results[i].colliding() != (bool)serial[i] || results[i].object != reference[i].object) {
+				std::printf("mismatch at %u threads, mover %zu: object %d, serial %s, one thread object %d\n",
+					threads, i, results[i].object, serial[i] ? "colliding" : "free", reference[i].object);
+				return 1;
+			}
+		}
+
+		std::printf("%8u %14.1f %10.2f\n", threads, batchTime / movers.size() * 1e9, serialTime / batchTime);
+	}
+
+	return 0;
+}
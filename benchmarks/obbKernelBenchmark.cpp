@@ -0,0 +1,99 @@
+// Tests per second of BoundingBox::isIntersectingOtherBB, OBB::intersects and the batched
+// OBB kernel, for one box against every box of a random scene.
+#include "../src/BoundingBox.cpp"
+#include "../src/Spatial/OBB.cpp"
+#include "../src/Collision/OBBKernel.cpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static BoundingBox randomBox(std::mt19937& rng, float worldSize) {
+	std::uniform_real_distribution<float> position(-worldSize, worldSize);
+	std::uniform_real_distribution<float> size(0.2f, 2.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.283f);
+
+	glm::vec3 half(size(rng), size(rng), size(rng));
+	std::vector<float> vertices(24, 0.0f);
+	BoundingBox box(vertices, -half, half);
+
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(position(rng), position(rng), position(rng)));
+	model = glm::rotate(model, angle(rng), glm::vec3(1, 0, 0));
+	model = glm::rotate(model, angle(rng), glm::vec3(0, 1, 0));
+	model = glm::rotate(model, angle(rng), glm::vec3(0, 0, 1));
+	box.setTransformation(model);
+
+	return box;
+}
+
+static OBB toOBB(const BoundingBox& box) {
+	return OBB::fromMinMax(box.minVert, box.maxVert).transformed(box.transformation);
+}
+
+template <typename Function>
+static double secondsPerRun(Function function, int runs) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < runs; i++) {
+		function();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / runs;
+}
+
+int main(int argc, char** argv) {
+	int count = argc > 1 ? std::atoi(argv[1]) : 10000;
+	int runs = argc > 2 ? std::atoi(argv[2]) : 20;
+
+	// dense enough that a good share of the boxes overlap the query
+	std::mt19937 rng(42);
+	float worldSize = 0.5f * std::cbrt((float)count);
+	std::vector<BoundingBox> boxes;
+	std::vector<OBB> obbs;
+	OBBSet set;
+	for (int i = 0; i < count; i++) {
+		boxes.push_back(randomBox(rng, worldSize));
+		obbs.push_back(toOBB(boxes.back()));
+		set.add(obbs.back());
+	}
+
+	BoundingBox query = randomBox(rng, 0.0f);
+	OBB queryOBB = toOBB(query);
+
+	std::vector<unsigned char> reference(count), single(count);
+	double original = secondsPerRun([&]() {
+		for (int i = 0; i < count; i++) {
+			reference[i] = query.isIntersectingOtherBB(boxes[i], glm::vec3(0.0f));
+		}
+	}, runs);
+	double pod = secondsPerRun([&]() {
+		for (int i = 0; i < count; i++) {
+			single[i] = queryOBB.intersects(obbs[i]);
+		}
+	}, runs);
+
+	std::vector<uint64_t> scalarMask, simdMask;
+	double scalar = secondsPerRun([&]() { OBBKernel::overlapMaskScalar(queryOBB, set, scalarMask); }, runs);
+	double simd = secondsPerRun([&]() { OBBKernel::overlapMask(queryOBB, set, simdMask); }, runs);
+
+	int overlaps = 0, mismatches = 0;
+	for (int i = 0; i < count; i++) {
+		overlaps += reference[i];
+		mismatches += single[i] != reference[i];
+		mismatches += OBBKernel::isSet(simdMask, i) != (bool)reference[i];
+		mismatches += OBBKernel::isSet(scalarMask, i) != OBBKernel::isSet(simdMask, i);
+	}
+
+	std::cout << count << " boxes, " << overlaps << " overlapping, " << mismatches << " mismatches, "
+		<< FloatPack::WIDTH << " lanes" << std::endl;
+	std::cout << "isIntersectingOtherBB: " << count / original / 1e6 << " M tests/s" << std::endl;
+	std::cout << "OBB::intersects:       " << count / pod / 1e6 << " M tests/s" << std::endl;
+	std::cout << "OBBKernel scalar:      " << count / scalar / 1e6 << " M tests/s" << std::endl;
+	std::cout << "OBBKernel SIMD:        " << count / simd / 1e6 << " M tests/s" << std::endl;
+
+	return mismatches == 0 ? 0 : 1;
+}
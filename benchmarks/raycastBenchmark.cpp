@@ -0,0 +1,145 @@
+// Rays per second of CollisionWorld::raycast, one ray at a time against the packet
+// overload, for both broadphases. Every packet result is checked against the single
+// ray result, a mismatch fails the run.
+// Usage: RaycastBenchmark [rays per scene]
+#include "../src/Collision/CollisionWorld.cpp"
+#include "../src/Primitives/Sphere.cpp"
+#include "../src/Primitives/Cuboid.cpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+static const Shader NO_SHADER;
+
+int main(int argc, char** argv) {
+	int rayCount = argc > 1 ? std::atoi(argv[1]) : 10000;
+	const int sizes[] = { 1000, 10000 };
+	const BroadphaseType broadphases[] = { AABB_TREE, HASH_GRID };
+	const char* broadphaseNames[] = { "tree", "grid" };
+	const int RUNS = 5;
+
+	// no GL context here, the meshes are only kept on the CPU for the narrow phase
+	Primitive::headless = true;
+	Primitive::keepCPUGeometry = true;
+
+	std::printf("%d rays per scene\n", rayCount);
+	std::printf("%8s %6s %6s %14s %14s %8s\n", "objects", "phase", "rays", "single ns", "packet ns", "hits");
+
+	for (int count : sizes) {
+		std::mt19937 rng(11);
+		float worldSize = std::cbrt((float)count * 8.0f) * 0.5f;
+		std::uniform_real_distribution<float> position(-worldSize, worldSize);
+		std::uniform_real_distribution<float> size(0.3f, 2.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 6.283f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		glm::vec3 zero(0.0f), one(1.0f);
+
+		// cuboids and spheres, some unevenly scaled, every fourth one moving
+		std::vector<Primitive> objects;
+		TransformStore transforms;
+		for (int i = 0; i < count; i++) {
+			glm::vec3 translation(position(rng), position(rng), position(rng));
+			glm::vec3 rotation(angle(rng), angle(rng), angle(rng));
+			glm::vec3 scale = i % 3 == 0 ? glm::vec3(size(rng), size(rng), size(rng)) : glm::vec3(size(rng));
+			if (i % 2 == 0) {
+				objects.push_back(Cuboid(NO_SHADER, NO_SHADER, translation, scale, rotation, zero, one, one, true, nullptr, nullptr));
+			} else {
+				objects.push_back(Sphere(NO_SHADER, NO_SHADER, translation, scale, rotation, zero, 0.5f, 12, one, true));
+			}
+			objects.back().transformId = transforms.add(translation, rotation, scale);
+			objects.back().dynamic = i % 4 == 0;
+		}
+		transforms.update();
+
+		std::vector<AABB> bounds;
+		for (Primitive& object : objects) {
+			object.bb = object.localBB.transformed(transforms.world[object.transformId]);
+			bounds.push_back(object.bb.bounds());
+		}
+
+		// incoherent rays: random origins and directions, a third of them unbounded
+		std::vector<Ray> randomRays;
+		for (int i = 0; i < rayCount; i++) {
+			glm::vec3 direction(unit(rng), unit(rng), unit(rng));
+			if (glm::dot(direction, direction) < 1e-4f) {
+				direction = glm::vec3(1.0f, 0.0f, 0.0f);
+			}
+			glm::vec3 origin(position(rng), position(rng), position(rng));
+			randomRays.push_back(Ray(origin, glm::normalize(direction), i % 3 == 0 ? INFINITY : worldSize));
+		}
+
+		// coherent rays: the pixels of a camera outside the scene looking at its center,
+		// ordered in tiles of RayPacket::WIDTH neighbouring pixels like a picking or
+		// visibility pass would cast them
+		std::vector<Ray> cameraRays;
+		int side = std::max((int)std::sqrt((float)rayCount), 2);
+		int tileWidth = std::max(RayPacket::WIDTH / 2, 1), tileHeight = RayPacket::WIDTH / tileWidth;
+		glm::vec3 eye(0.0f, 0.0f, -3.0f * worldSize);
+		for (int tileY = 0; tileY < side; tileY += tileHeight) {
+			for (int tileX = 0; tileX < side; tileX += tileWidth) {
+				for (int y = tileY; y < std::min(tileY + tileHeight, side); y++) {
+					for (int x = tileX; x < std::min(tileX + tileWidth, side); x++) {
+						glm::vec3 target(worldSize * (2.0f * x / (side - 1) - 1.0f), worldSize * (2.0f * y / (side - 1) - 1.0f), 0.0f);
+						cameraRays.push_back(Ray(eye, glm::normalize(target - eye)));
+					}
+				}
+			}
+		}
+
+		const std::vector<Ray>* rayTables[] = { &randomRays, &cameraRays };
+		const char* rayNames[] = { "random", "camera" };
+		for (int set = 0; set < 2; set++) {
+			const std::vector<Ray>& rays = *rayTables[set];
+			for (int b = 0; b < 2; b++) {
+				CollisionWorld world(objects, transforms, broadphases[b]);
+				world.update(bounds, std::vector<unsigned int>());
+
+				// best of a few runs, the first ones also warm the caches
+				std::vector<RaycastHit> single(rays.size()), packet;
+				double singleTime = INFINITY, packetTime = INFINITY;
+				for (int run = 0; run < RUNS; run++) {
+					auto start = std::chrono::steady_clock::now();
+					for (size_t i = 0; i < rays.size(); i++) {
+						single[i] = world.raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance);
+					}
+					singleTime = std::min(singleTime, secondsSince(start));
+
+					start = std::chrono::steady_clock::now();
+					world.raycast(rays, packet);
+					packetTime = std::min(packetTime, secondsSince(start));
+				}
+
+				size_t hits = 0;
+				for (size_t i = 0; i < rays.size(); i++) {
+					hits += single[i].hit();
+					// objects hit at the same distance, e.g. overlapping ones around the origin,
+					// may be reported by either path
+					bool sameDistance = std::fabs(single[i].distance - packet[i].distance) <= 1e-4f * std::max(1.0f, single[i].distance);
+					bool same = single[i].hit() == packet[i].hit() && (!single[i].hit() || sameDistance);
+					if (!same) {
+						std::printf("mismatch at %d objects (%s, %s rays), ray %zu: object %d/%d, distance %f/%f\n",
+							count, broadphaseNames[b], rayNames[set], i, single[i].object, packet[i].object, single[i].distance, packet[i].distance);
+						return 1;
+					}
+				}
+
+				std::printf("%8d %6s %6s %14.1f %14.1f %8zu\n", count, broadphaseNames[b], rayNames[set],
+					singleTime / rays.size() * 1e9, packetTime / rays.size() * 1e9, hits);
+			}
+		}
+	}
+
+	return 0;
+}
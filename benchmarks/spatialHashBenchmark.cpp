@@ -0,0 +1,102 @@
+// Build time and query latency of the spatial hash grid against a linear scan over
+// the object bounds, for scenes of wall sized pieces at constant density.
+#include "../src/Collision/SpatialHashGrid.cpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+	float cellSize = argc > 1 ? (float)std::atof(argv[1]) : 2.0f;
+	const int queryCount = 10000;
+	const int sizes[] = { 1000, 10000, 100000 };
+
+	std::printf("cell size %.2f, %d queries per scene\n", cellSize, queryCount);
+	std::printf("%8s %14s %14s %14s %14s %14s %14s\n", "objects", "grid build ms", "scan build ms",
+		"grid box ns", "scan box ns", "grid radius ns", "scan radius ns");
+
+	for (int count : sizes) {
+		std::mt19937 rng(7);
+		// about one piece per 8 cubic units, like a dense indoor level
+		float worldSize = std::cbrt((float)count * 8.0f) * 0.5f;
+		std::uniform_real_distribution<float> position(-worldSize, worldSize);
+		std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+		std::vector<AABB> bounds;
+		for (int i = 0; i < count; i++) {
+			glm::vec3 center(position(rng), position(rng), position(rng));
+			glm::vec3 half(size(rng), size(rng), 0.1f);
+			bounds.push_back(AABB(center - half, center + half));
+		}
+
+		std::vector<glm::vec3> centers;
+		for (int i = 0; i < queryCount; i++) {
+			centers.push_back(glm::vec3(position(rng), position(rng), position(rng)));
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		SpatialHashGrid grid(cellSize);
+		for (int i = 0; i < count; i++) {
+			grid.insert(i, bounds[i]);
+		}
+		double gridBuild = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		std::vector<AABB> scan(bounds.begin(), bounds.end());
+		double scanBuild = secondsSince(start);
+
+		// the camera's unit box
+		size_t gridHits = 0, scanHits = 0;
+		start = std::chrono::steady_clock::now();
+		for (const glm::vec3& center : centers) {
+			grid.query(AABB(center - glm::vec3(0.5f), center + glm::vec3(0.5f)), [&](unsigned int) { gridHits++; return true; });
+		}
+		double gridBox = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		for (const glm::vec3& center : centers) {
+			AABB box(center - glm::vec3(0.5f), center + glm::vec3(0.5f));
+			for (const AABB& b : scan) {
+				scanHits += b.overlaps(box);
+			}
+		}
+		double scanBox = secondsSince(start);
+
+		size_t gridRadiusHits = 0, scanRadiusHits = 0;
+		const float radius = 3.0f;
+		start = std::chrono::steady_clock::now();
+		for (const glm::vec3& center : centers) {
+			grid.queryRadius(center, radius, [&](unsigned int) { gridRadiusHits++; return true; });
+		}
+		double gridRadius = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		for (const glm::vec3& center : centers) {
+			for (const AABB& b : scan) {
+				glm::vec3 offset = glm::min(glm::max(center, b.min), b.max) - center;
+				scanRadiusHits += glm::dot(offset, offset) <= radius * radius;
+			}
+		}
+		double scanRadius = secondsSince(start);
+
+		if (gridHits != scanHits || gridRadiusHits != scanRadiusHits) {
+			std::printf("mismatch at %d objects: %zu/%zu box hits, %zu/%zu radius hits\n",
+				count, gridHits, scanHits, gridRadiusHits, scanRadiusHits);
+			return 1;
+		}
+
+		std::printf("%8d %14.3f %14.3f %14.1f %14.1f %14.1f %14.1f\n", count, gridBuild * 1e3, scanBuild * 1e3,
+			gridBox / queryCount * 1e9, scanBox / queryCount * 1e9, gridRadius / queryCount * 1e9, scanRadius / queryCount * 1e9);
+	}
+
+	return 0;
+}
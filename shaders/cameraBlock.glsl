@@ -0,0 +1,7 @@
+// Per-frame camera data, see CameraBlock in Rendering/FrameUniforms.cpp
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    mat4 lightSpaceMatrix;
+    vec3 viewPos;
+};
@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 solidColor;
+
+// Unlit, so the picked object's box shows in the same color under every light
+void main()
+{
+    FragColor = vec4(solidColor, 1.0);
+}
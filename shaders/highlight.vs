@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+// per instance
+layout (location = 3) in mat4 model;
+layout (location = 7) in vec3 aSolidColor;
+
+out vec3 solidColor;
+
+#include "cameraBlock.glsl"
+
+void main()
+{
+    solidColor = aSolidColor;
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
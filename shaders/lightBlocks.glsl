@@ -0,0 +1,29 @@
+#include "lightingPermutation.glsl"
+
+struct DirLight {
+    vec3 direction;
+	
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// members ordered so that every vec3 is followed by a float in std140
+struct PointLight {
+    vec3 position;
+    float constant;
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+};
+
+// Per-frame light data, see LightsBlock in Rendering/FrameUniforms.cpp. The buffer holds
+// MAX_POINT_LIGHTS lights, a program only declares the ones it uses.
+layout (std140) uniform Lights {
+    DirLight dirLight;
+#if NR_POINT_LIGHTS > 0
+    PointLight pointLights[NR_POINT_LIGHTS];
+#endif
+};
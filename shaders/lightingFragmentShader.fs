@@ -1,95 +1,84 @@
 #version 330 core
 out vec4 FragColor;
 
+#include "lightBlocks.glsl"
+#include "cameraBlock.glsl"
+
+// Only the shininess is read by solid color permutations
 struct Material {
+#if !SOLID_COLOR
     sampler2D diffuse;
     sampler2D specular;
+#endif
     float shininess;
 }; 
 
-struct DirLight {
-    vec3 direction;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-    
-    float constant;
-    float linear;
-    float quadratic;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-#define NR_POINT_LIGHTS 1
-
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in vec3 solidColor;
 
-in vec4 FragPosLightSpace; 
-
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform Material material;
-uniform bool useSolidColor;
-uniform vec3 solidColor;
 
+#if SHADOWS
+in vec4 FragPosLightSpace; 
 uniform sampler2D shadowMap;
+#endif
 
-
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
+#if SHADOWS
 float DirectLightShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir);
+#endif
 
 void main()
 {    
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
 
-    vec3 dirLightColor = CalcDirLight(dirLight, norm, viewDir);
+    // surface colors, read once for all lights
+#if SOLID_COLOR
+    vec3 diffuseColor = solidColor;
+    vec3 specularColor = solidColor;
+#else
+    vec3 diffuseColor = vec3(texture(material.diffuse, TexCoords));
+    vec3 specularColor = vec3(texture(material.specular, TexCoords));
+#endif
+
+    vec3 dirLightColor = CalcDirLight(dirLight, norm, viewDir, diffuseColor, specularColor);
+#if SHADOWS
     float shadow = DirectLightShadowCalculation(FragPosLightSpace, norm, normalize(-dirLight.direction));
+#else
+    float shadow = 0.0;
+#endif
     
     vec3 pointLightsColor = vec3(0.0);
+#if NR_POINT_LIGHTS > 0
     for(int i = 0; i < NR_POINT_LIGHTS; i++) {
-        pointLightsColor += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+        pointLightsColor += CalcPointLight(pointLights[i], norm, FragPos, viewDir, diffuseColor, specularColor);
     }
+#endif
 
     vec3 result = (1.0 - shadow) * dirLightColor + pointLightsColor;
 
     FragColor = vec4(result, 1.0);
 }
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor)
 {
     vec3 lightDir = normalize(-light.direction);
     float diff = max(dot(normal, lightDir), 0.0);
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     
-    vec3 ambient, diffuse, specular;
-    if (useSolidColor) {
-        ambient = light.ambient * solidColor;
-        diffuse = light.diffuse * diff * solidColor;
-        specular = light.specular * spec * solidColor;
-    } else {
-        ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-        diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-        specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    }
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
     
     return (ambient + diffuse + specular);
 }
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor)
 {
     vec3 lightDir = normalize(light.position - fragPos);
     float diff = max(dot(normal, lightDir), 0.0);
@@ -98,16 +87,9 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     
-    vec3 ambient, diffuse, specular;
-    if (useSolidColor) {
-        ambient = light.ambient * solidColor;
-        diffuse = light.diffuse * diff * solidColor;
-        specular = light.specular * spec * solidColor;
-    } else {
-        ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-        diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-        specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    }
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
     
     ambient *= attenuation;
     diffuse *= attenuation;
@@ -115,6 +97,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     return (ambient + diffuse + specular);
 }
 
+#if SHADOWS
 float DirectLightShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
 {
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
@@ -141,4 +124,5 @@ float DirectLightShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lig
     shadow /= 9.0;
 
     return shadow;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
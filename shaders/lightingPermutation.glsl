@@ -0,0 +1,15 @@
+// Switches of the lighting shader's permutations, injected per object by ShaderVariants.
+// The defaults are the most general program, for builds without defines.
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 1
+#endif
+
+// 1 lights the instance color, 0 the material's textures
+#ifndef SOLID_COLOR
+#define SOLID_COLOR 0
+#endif
+
+// 0 leaves out the shadow map lookup
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
@@ -8,7 +8,7 @@ in VS_OUT {
 
 const float MAGNITUDE = 0.2;
 
-uniform mat4 projection;
+#include "cameraBlock.glsl"
 
 void GenerateLine(int index)
 {
@@ -1,17 +1,21 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+// only has w = 1 for meshes with octahedral normals, see VertexFormat
+layout (location = 11) in vec4 aOctNormal;
 
 out VS_OUT {
     vec3 normal;
 } vs_out;
 
-uniform mat4 view;
+#include "cameraBlock.glsl"
+#include "octahedralNormal.glsl"
+
 uniform mat4 model;
 
 void main()
 {
     mat3 normalMatrix = mat3(transpose(inverse(view * model)));
-    vs_out.normal = vec3(vec4(normalMatrix * aNormal, 0.0));
+    vs_out.normal = vec3(vec4(normalMatrix * VertexNormal(aNormal, aOctNormal), 0.0));
     gl_Position = view * model * vec4(aPos, 1.0); 
 }
\ No newline at end of file
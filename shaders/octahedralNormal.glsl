@@ -0,0 +1,14 @@
+// Normal of the vertex, from the octahedral encoding at location 11 when the mesh has one,
+// see VertexFormat. The generic value of location 11 has w = 0 for the other meshes.
+vec3 DecodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+vec3 VertexNormal(vec3 normal, vec4 octNormal)
+{
+	return octNormal.w > 0.5 ? DecodeOctahedral(octNormal.xy) : normal;
+}
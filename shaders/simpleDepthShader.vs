@@ -1,8 +1,9 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+// per instance
+layout (location = 3) in mat4 model;
 
-uniform mat4 lightSpaceMatrix;
-uniform mat4 model;
+#include "cameraBlock.glsl"
 
 void main()
 {
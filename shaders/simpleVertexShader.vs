@@ -1,28 +1,40 @@
 #version 330 core
+#include "lightingPermutation.glsl"
+
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per instance
+layout (location = 3) in mat4 model;
+layout (location = 7) in vec3 aSolidColor;
+layout (location = 8) in mat3 normalMatrix;
+// only has w = 1 for meshes with octahedral normals, see VertexFormat
+layout (location = 11) in vec4 aOctNormal;
 
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 Pos;
+out vec3 solidColor;
 
+#if SHADOWS
 out vec4 FragPosLightSpace;
+#endif
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+#include "cameraBlock.glsl"
+#include "octahedralNormal.glsl"
 
 void main()
 {
 	FragPos = vec3(model * vec4(aPos, 1.0));
-	Normal = mat3(transpose(inverse(model))) * aNormal;
+	Normal = normalMatrix * VertexNormal(aNormal, aOctNormal);
 	TexCoords = aTexCoords;
 	Pos = aPos;
+	solidColor = aSolidColor;
 
+#if SHADOWS
 	FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
+#endif
 
 	gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
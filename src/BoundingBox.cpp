@@ -7,6 +7,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <limits>
 
+// The original collision box, replaced by OBB in the scene. Kept as the reference
+// implementation the collision benchmarks compare against.
 class BoundingBox {
 public:
     std::vector<float> vertices;
@@ -20,7 +22,7 @@ public:
         : vertices(vertices), minVert(minVert), maxVert(maxVert), transformation(glm::mat4(1.0f)) {}
 
     // FIND OUT HOW IT ACTUALLY WORKS
-    float projectOntoAxis(const glm::vec3& axis) {
+    float projectOntoAxis(const glm::vec3& axis) const {
         glm::vec3 center = (minVert + maxVert) * 0.5f;
         glm::vec3 extent = (maxVert - minVert) * 0.5f;
 
@@ -42,7 +44,7 @@ public:
         return radius;
     }
 
-    bool isIntersectingOtherBB(BoundingBox otherBB, glm::vec3 positionDelta) {
+    bool isIntersectingOtherBB(const BoundingBox& otherBB, glm::vec3 positionDelta) {
         glm::mat4 thisTransform = glm::translate(glm::mat4(1.0f), positionDelta) * transformation;
 
         glm::vec3 axes[15];
@@ -1,8 +1,9 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
-#include "BoundingBox.cpp"
+#include "Spatial/OBB.cpp"
 #include "Primitives/Primitive.cpp"
+#include "Collision/CollisionWorld.cpp"
 
 #include "../dependencies/glad.h"
 #include <glm/glm.hpp>
@@ -39,7 +40,10 @@ public:
     float MouseSensitivity;
     float Zoom;
 
-    BoundingBox bb;
+    // collision box, an axis aligned unit cube around Position
+    OBB bb;
+    // identifies the camera in the collision world's per mover caches
+    unsigned int moverId = 0;
 
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM) {
         Position = position;
@@ -48,29 +52,7 @@ public:
         Pitch = pitch;
         updateCameraVectors();
 
-        float minX = -0.5f;
-        float maxX =  0.5f;
-        float minY = -0.5f;
-        float maxY =  0.5f;
-        float minZ = -0.5f;
-        float maxZ =  0.5f;
-
-
-        std::vector<float> bbVertices = {
-			minX, minY, maxZ, // 0: front-bottom-left
-			maxX, minY, maxZ, // 1: front-bottom-right
-			maxX, maxY, maxZ, // 2: front-top-right
-			minX, maxY, maxZ, // 3: front-top-left
-			minX, minY, minZ, // 4: back-bottom-left
-			maxX, minY, minZ, // 5: back-bottom-right
-			maxX, maxY, minZ, // 6: back-top-right
-			minX, maxY, minZ  // 7: back-top-left
-		};
-
-        glm::vec3 minVert = glm::vec3(minX, minY, minZ);
-		glm::vec3 maxVert = glm::vec3(maxX, maxY, maxZ);
-		
-		bb = BoundingBox(bbVertices, minVert, maxVert);
+        bb = OBB::fromMinMax(glm::vec3(-0.5f), glm::vec3(0.5f));
         updateBoundingBox(Position);
     }
 
@@ -81,29 +63,7 @@ public:
         Pitch = pitch;
         updateCameraVectors();
 
-        float minX = -0.5f;
-        float maxX =  0.5f;
-        float minY = -0.5f;
-        float maxY =  0.5f;
-        float minZ = -0.5f;
-        float maxZ =  0.5f;
-
-
-        std::vector<float> bbVertices = {
-			minX, minY, maxZ, // 0: front-bottom-left
-			maxX, minY, maxZ, // 1: front-bottom-right
-			maxX, maxY, maxZ, // 2: front-top-right
-			minX, maxY, maxZ, // 3: front-top-left
-			minX, minY, minZ, // 4: back-bottom-left
-			maxX, minY, minZ, // 5: back-bottom-right
-			maxX, maxY, minZ, // 6: back-top-right
-			minX, maxY, minZ  // 7: back-top-left
-		};
-
-        glm::vec3 minVert = glm::vec3(minX, minY, minZ);
-		glm::vec3 maxVert = glm::vec3(maxX, maxY, maxZ);
-		
-		bb = BoundingBox(bbVertices, minVert, maxVert);
+        bb = OBB::fromMinMax(glm::vec3(-0.5f), glm::vec3(0.5f));
         updateBoundingBox(Position);
     }
 
@@ -111,12 +71,10 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
 
-    void ProcessKeyboard(Camera_Movement direction, float deltaTime, std::vector<Primitive> objects) {
+    void ProcessKeyboard(Camera_Movement direction, float deltaTime, const CollisionWorld& world) {
         float velocity = MovementSpeed * deltaTime;
         glm::vec3 positionDelta = glm::vec3(0, 0, 0);
 
-        bool intersects = false;
-
         if (direction == FORWARD) {
             positionDelta = Front * velocity;
         }
@@ -132,15 +90,9 @@ public:
 
         // std::cout << "PositionDelta: " << positionDelta.x << ", " << positionDelta.y << ", " << positionDelta.z << std::endl;
 
-        for (int i = 0; i < objects.size(); i++) {
-            if (bb.isIntersectingOtherBB(objects[i].bb, positionDelta)) {
-                intersects = true;
-                // std::cout << "COLLISION" << " with " << i << " object!" << std::endl;
-                break; 
-            }
-        }
-
-        if (!intersects) {
+        // only objects whose bounds overlap the moved box are SAT tested, most of them
+        // by the axis that separated them last time
+        if (!world.isColliding(moverId, bb, positionDelta)) {
             Position += positionDelta;
             updateBoundingBox(positionDelta);
         }
@@ -176,8 +128,7 @@ private:
     }
 
     void updateBoundingBox(glm::vec3 positionDelta) {
-        bb.minVert += positionDelta;
-        bb.maxVert += positionDelta;
+        bb.center += positionDelta;
     }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,336 @@
+#ifndef COLLIDER_H
+#define COLLIDER_H
+
+#include "TriangleBoxKernel.cpp"
+#include "../Primitives/GeometryCache.cpp"
+#include "../Spatial/OBB.cpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+enum ColliderType {
+	COLLIDER_SPHERE,
+	COLLIDER_BOX,
+	COLLIDER_PLANE,    // bounded rectangle, a box whose z half extent is 0
+	COLLIDER_TRIANGLE,
+	COLLIDER_TYPE_COUNT
+};
+
+// World space collision shape of a scene object, picked from the type of primitive it was
+// built as. Plain data with a type tag: box and plane use box, the sphere uses box.center
+// and radius and the triangle its corners.
+struct Collider {
+	ColliderType type = COLLIDER_BOX;
+	OBB box = OBB::fromMinMax(glm::vec3(0.0f), glm::vec3(0.0f));
+	float radius = 0.0f;
+	glm::vec3 corners[3];
+	bool approximate = false; // the box only bounds the shape, its triangles have the last word
+	bool closed = false;      // the shape encloses a volume, a box inside it touches no triangle
+
+	static Collider fromBox(const OBB& box) {
+		Collider collider;
+		collider.box = box;
+		return collider;
+	}
+
+	// The shape of a primitive built from key under the model matrix world. worldBB is the
+	// object's collision box, used for circles and when the transform distorts the shape (a
+	// sphere under non-uniform scale, a rectangle sheared by scale after rotation).
+	static Collider fromPrimitive(const GeometryKey& key, const glm::mat4& world, const OBB& worldBB) {
+		Collider collider = fromBox(worldBB);
+		const float* p = key.params;
+		glm::mat3 linear(world);
+
+		// primitives whose geometry was rejected have no parameters
+		if (key.paramCount == 0) {
+			return collider;
+		}
+
+		switch (key.type) {
+		case SPHERE: {
+			float scale = glm::length(linear[0]);
+			if (!isUniform(linear, scale)) {
+				collider.approximate = true;
+				collider.closed = true;
+				break;
+			}
+			collider.type = COLLIDER_SPHERE;
+			collider.box = OBB::fromMinMax(glm::vec3(0.0f), glm::vec3(0.0f));
+			collider.box.center = glm::vec3(world * glm::vec4(p[0], p[1], p[2], 1.0f));
+			collider.radius = p[3] * scale;
+			break;
+		}
+		case QUAD: {
+			glm::vec2 half = glm::vec2(p[2], p[3]) * 0.5f;
+			glm::vec3 center(p[0], p[1], 0.0f);
+			if (!isOrthogonal(linear)) {
+				collider.approximate = true;
+				break;
+			}
+			collider.type = COLLIDER_PLANE;
+			collider.box = OBB::fromMinMax(center - glm::vec3(half, 0.0f), center + glm::vec3(half, 0.0f)).transformed(world);
+			break;
+		}
+		case TRIANGLE:
+			// affine maps keep triangles exact
+			collider.type = COLLIDER_TRIANGLE;
+			for (int k = 0; k < 3; k++) {
+				collider.corners[k] = glm::vec3(world * glm::vec4(p[k * 2], p[k * 2 + 1], 0.0f, 1.0f));
+			}
+			break;
+		case CIRCLE:
+			// no disc collider, the box leaves it to the mesh narrow phase
+			collider.approximate = true;
+			break;
+		case CUBOID:
+			collider.closed = true;
+			collider.approximate = !isOrthogonal(linear);
+			break;
+		}
+
+		return collider;
+	}
+
+private:
+	static bool isOrthogonal(const glm::mat3& linear) {
+		glm::vec3 x = glm::normalize(linear[0]), y = glm::normalize(linear[1]), z = glm::normalize(linear[2]);
+		return std::fabs(glm::dot(x, y)) < 1e-4f && std::fabs(glm::dot(y, z)) < 1e-4f && std::fabs(glm::dot(x, z)) < 1e-4f;
+	}
+
+	static bool isUniform(const glm::mat3& linear, float scale) {
+		return isOrthogonal(linear)
+			&& std::fabs(glm::length(linear[1]) - scale) < 1e-4f * scale
+			&& std::fabs(glm::length(linear[2]) - scale) < 1e-4f * scale;
+	}
+};
+
+// Closed form overlap tests for every pair of collider types. PairTest<A, B> is specialized
+// for A <= B and the primary template swaps its arguments, so ColliderTests::TABLE is filled
+// at compile time and a test costs one indexed call instead of a virtual dispatch.
+template <int A, int B>
+struct PairTest {
+	static bool test(const Collider& a, const Collider& b) {
+		return PairTest<B, A>::test(b, a);
+	}
+};
+
+namespace ColliderMath {
+
+	// Point of box, or of a plane with its zero extent, closest to point
+	inline glm::vec3 closestPointOnBox(const OBB& box, const glm::vec3& point) {
+		glm::vec3 local = (point - box.center) * box.rotation;
+		local = glm::min(glm::max(local, -box.halfExtents), box.halfExtents);
+		return box.center + box.rotation * local;
+	}
+
+	// Ericson, Real-Time Collision Detection 5.1.5
+	inline glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+		glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+		float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+		glm::vec3 bp = p - b;
+		float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3) return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+		glm::vec3 cp = p - c;
+		float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6) return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		float denominator = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	inline bool sphereTouches(const Collider& sphere, const glm::vec3& closest) {
+		glm::vec3 offset = closest - sphere.box.center;
+		return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+	}
+
+	// The four corners of a plane collider
+	inline void planeCorners(const OBB& plane, glm::vec3 corners[4]) {
+		glm::vec3 u = plane.rotation[0] * plane.halfExtents.x, v = plane.rotation[1] * plane.halfExtents.y;
+		corners[0] = plane.center - u - v;
+		corners[1] = plane.center + u - v;
+		corners[2] = plane.center + u + v;
+		corners[3] = plane.center - u + v;
+	}
+
+	inline bool separatesOn(const glm::vec3& axis, const glm::vec3* a, int countA, const glm::vec3* b, int countB) {
+		if (glm::dot(axis, axis) < 1e-12f) {
+			return false;
+		}
+
+		float minA = INFINITY, maxA = -INFINITY, minB = INFINITY, maxB = -INFINITY;
+		for (int i = 0; i < countA; i++) {
+			float d = glm::dot(axis, a[i]);
+			minA = std::min(minA, d);
+			maxA = std::max(maxA, d);
+		}
+		for (int i = 0; i < countB; i++) {
+			float d = glm::dot(axis, b[i]);
+			minB = std::min(minB, d);
+			maxB = std::max(maxB, d);
+		}
+		return minA > maxB || minB > maxA;
+	}
+
+	// Separating axis test of two flat convex polygons: both normals, the cross products of
+	// their edges and, for coplanar polygons, the in-plane edge normals
+	inline bool polygonsIntersect(const glm::vec3* a, int countA, const glm::vec3* b, int countB) {
+		glm::vec3 normalA = glm::cross(a[1] - a[0], a[2] - a[0]);
+		glm::vec3 normalB = glm::cross(b[1] - b[0], b[2] - b[0]);
+		if (separatesOn(normalA, a, countA, b, countB) || separatesOn(normalB, a, countA, b, countB)) {
+			return false;
+		}
+
+		for (int i = 0; i < countA; i++) {
+			glm::vec3 edgeA = a[(i + 1) % countA] - a[i];
+			if (separatesOn(glm::cross(normalA, edgeA), a, countA, b, countB)) {
+				return false;
+			}
+			for (int j = 0; j < countB; j++) {
+				glm::vec3 edgeB = b[(j + 1) % countB] - b[j];
+				if (separatesOn(glm::cross(edgeA, edgeB), a, countA, b, countB)) {
+					return false;
+				}
+			}
+		}
+
+		for (int j = 0; j < countB; j++) {
+			glm::vec3 edgeB = b[(j + 1) % countB] - b[j];
+			if (separatesOn(glm::cross(normalB, edgeB), a, countA, b, countB)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+template <>
+struct PairTest<COLLIDER_SPHERE, COLLIDER_SPHERE> {
+	static bool test(const Collider& a, const Collider& b) {
+		glm::vec3 offset = b.box.center - a.box.center;
+		float reach = a.radius + b.radius;
+		return glm::dot(offset, offset) <= reach * reach;
+	}
+};
+
+template <>
+struct PairTest<COLLIDER_SPHERE, COLLIDER_BOX> {
+	static bool test(const Collider& sphere, const Collider& box) {
+		return ColliderMath::sphereTouches(sphere, ColliderMath::closestPointOnBox(box.box, sphere.box.center));
+	}
+};
+
+template <>
+struct PairTest<COLLIDER_SPHERE, COLLIDER_PLANE> {
+	static bool test(const Collider& sphere, const Collider& plane) {
+		return ColliderMath::sphereTouches(sphere, ColliderMath::closestPointOnBox(plane.box, sphere.box.center));
+	}
+};
+
+template <>
+struct PairTest<COLLIDER_SPHERE, COLLIDER_TRIANGLE> {
+	static bool test(const Collider& sphere, const Collider& triangle) {
+		const glm::vec3* v = triangle.corners;
+		return ColliderMath::sphereTouches(sphere, ColliderMath::closestPointOnTriangle(sphere.box.center, v[0], v[1], v[2]));
+	}
+};
+
+template <>
+struct PairTest<COLLIDER_BOX, COLLIDER_BOX> {
+	static bool test(const Collider& a, const Collider& b) {
+		return a.box.intersects(b.box);
+	}
+};
+
+template <>
+struct PairTest<COLLIDER_BOX, COLLIDER_PLANE> {
+	static bool test(const Collider& box, const Collider& plane) {
+		// the plane's normal rejects most pairs before the full SAT
+		const glm::vec3& normal = plane.box.rotation[2];
+		float radius = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			radius += box.box.halfExtents[i] * std::fabs(glm::dot(box.box.rotation[i], normal));
+		}
+		if (std::fabs(glm::dot(box.box.center - plane.box.center, normal)) > radius) {
+			return false;
+		}
+		return box.box.intersects(plane.box);
+	}
+};
+
+template <>
+struct PairTest<COLLIDER_BOX, COLLIDER_TRIANGLE> {
+	static bool test(const Collider& box, const Collider& triangle) {
+		TriangleBatch batch;
+		glm::vec3 local[3];
+		for (int k = 0; k < 3; k++) {
+			local[k] = (triangle.corners[k] - box.box.center) * box.box.rotation;
+		}
+		batch.add(local[0], local[1], local[2]);
+		return TriangleBoxKernel::overlapMaskScalar(box.box.halfExtents, batch) != 0;
+	}
+};
+
+template <>
+struct PairTest<COLLIDER_PLANE, COLLIDER_PLANE> {
+	static bool test(const Collider& a, const Collider& b) {
+		glm::vec3 cornersA[4], cornersB[4];
+		ColliderMath::planeCorners(a.box, cornersA);
+		ColliderMath::planeCorners(b.box, cornersB);
+		return ColliderMath::polygonsIntersect(cornersA, 4, cornersB, 4);
+	}
+};
+
+template <>
+struct PairTest<COLLIDER_PLANE, COLLIDER_TRIANGLE> {
+	static bool test(const Collider& plane, const Collider& triangle) {
+		glm::vec3 corners[4];
+		ColliderMath::planeCorners(plane.box, corners);
+		return ColliderMath::polygonsIntersect(corners, 4, triangle.corners, 3);
+	}
+};
+
+template <>
+struct PairTest<COLLIDER_TRIANGLE, COLLIDER_TRIANGLE> {
+	static bool test(const Collider& a, const Collider& b) {
+		return ColliderMath::polygonsIntersect(a.corners, 3, b.corners, 3);
+	}
+};
+
+class ColliderTests {
+
+public:
+	typedef bool (*Test)(const Collider&, const Collider&);
+
+	static bool intersects(const Collider& a, const Collider& b) {
+		return TABLE[a.type][b.type](a, b);
+	}
+
+private:
+	static constexpr Test TABLE[COLLIDER_TYPE_COUNT][COLLIDER_TYPE_COUNT] = {
+		{ &PairTest<COLLIDER_SPHERE, COLLIDER_SPHERE>::test, &PairTest<COLLIDER_SPHERE, COLLIDER_BOX>::test,
+		  &PairTest<COLLIDER_SPHERE, COLLIDER_PLANE>::test, &PairTest<COLLIDER_SPHERE, COLLIDER_TRIANGLE>::test },
+		{ &PairTest<COLLIDER_BOX, COLLIDER_SPHERE>::test, &PairTest<COLLIDER_BOX, COLLIDER_BOX>::test,
+		  &PairTest<COLLIDER_BOX, COLLIDER_PLANE>::test, &PairTest<COLLIDER_BOX, COLLIDER_TRIANGLE>::test },
+		{ &PairTest<COLLIDER_PLANE, COLLIDER_SPHERE>::test, &PairTest<COLLIDER_PLANE, COLLIDER_BOX>::test,
+		  &PairTest<COLLIDER_PLANE, COLLIDER_PLANE>::test, &PairTest<COLLIDER_PLANE, COLLIDER_TRIANGLE>::test },
+		{ &PairTest<COLLIDER_TRIANGLE, COLLIDER_SPHERE>::test, &PairTest<COLLIDER_TRIANGLE, COLLIDER_BOX>::test,
+		  &PairTest<COLLIDER_TRIANGLE, COLLIDER_PLANE>::test, &PairTest<COLLIDER_TRIANGLE, COLLIDER_TRIANGLE>::test }
+	};
+};
+
+#endif
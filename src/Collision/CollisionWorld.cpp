@@ -0,0 +1,414 @@
+#ifndef COLLISIONWORLD_H
+#define COLLISIONWORLD_H
+
+#include "DynamicAABBTree.cpp"
+#include "SpatialHashGrid.cpp"
+#include "Collider.cpp"
+#include "MeshBVH.cpp"
+#include "SeparatingAxisCache.cpp"
+#include "TriangleBoxKernel.cpp"
+#include "../Spatial/StaticBVH.cpp"
+#include "../Spatial/OBB.cpp"
+#include "../Spatial/Ray.cpp"
+#include "../Primitives/Primitive.cpp"
+#include "../TransformStore.cpp"
+#include "../ThreadPool.cpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+enum BroadphaseType {
+	AABB_TREE, // static objects in a baked StaticBVH, moving ones in a dynamic AABB tree
+	HASH_GRID  // many objects of about the grid's cell size, e.g. wall pieces
+};
+
+struct RaycastHit {
+	int object = -1; // scene object index, -1 when nothing was hit
+	float distance = INFINITY;
+	glm::vec3 point = glm::vec3(0.0f);
+	glm::vec3 normal = glm::vec3(0.0f);
+
+	bool hit() const {
+		return object >= 0;
+	}
+};
+
+// One mover of a batched collision query
+struct MoverQuery {
+	OBB box;
+	glm::vec3 displacement;
+};
+
+struct MoverResult {
+	int object = -1; // first object found in the mover's way, -1 when it is free to move
+
+	bool colliding() const {
+		return object >= 0;
+	}
+};
+
+// Collision queries against the scene objects. A broadphase over the objects' world bounds
+// finds the few objects near a box, only those get the exact SAT test.
+// With AABB_TREE the static objects cost nothing per frame, only moving ones are updated.
+// The world refers to the scene instead of copying it, objects are identified by index.
+class CollisionWorld {
+
+public:
+	// Movers handed to a worker at a time by the batched isColliding
+	static const size_t MOVER_GRAIN = 16;
+
+	// When set, objects whose box only bounds their shape (circles, and shapes distorted by
+	// their transform like an unevenly scaled sphere) are also tested against their triangles
+	bool exactNarrowPhase = false;
+
+	// Objects tested by the SAT and triangles tested by the narrow phase during the last isColliding call
+	mutable unsigned int lastCandidates = 0;
+	mutable unsigned int lastTriangleTests = 0;
+
+	CollisionWorld(const std::vector<Primitive>& objects, const TransformStore& transforms, BroadphaseType broadphase = AABB_TREE, float cellSize = 2.0f)
+		: objects(objects), transforms(transforms), broadphase(broadphase), grid(cellSize) {}
+
+	// Adds objects new since the last call to the broadphase and moves the changed ones.
+	// bounds holds the world bounds of every object.
+	void update(const std::vector<AABB>& bounds, const std::vector<unsigned int>& changed) {
+		bool rebuildStatic = false;
+		proxies.resize(bounds.size(), -1);
+		inverseWorld.resize(bounds.size());
+		versions.resize(bounds.size(), 0);
+		colliders.resize(bounds.size());
+		meshes.resize(bounds.size(), nullptr);
+
+		for (unsigned int id = objectCount; id < bounds.size(); id++) {
+			inverseWorld[id] = glm::inverse(transforms.world[objects[id].transformId]);
+			meshes[id] = meshBVH(objects[id]);
+			colliders[id] = collider(id);
+
+			if (broadphase == HASH_GRID) {
+				grid.insert(id, bounds[id]);
+			} else if (objects[id].dynamic) {
+				proxies[id] = tree.createProxy(bounds[id], id);
+			} else {
+				rebuildStatic = true;
+			}
+		}
+
+		for (unsigned int id : changed) {
+			if (id >= objectCount) {
+				continue;
+			}
+			inverseWorld[id] = glm::inverse(transforms.world[objects[id].transformId]);
+			versions[id]++;
+			colliders[id] = collider(id);
+
+			if (broadphase == HASH_GRID) {
+				grid.move(id, bounds[id]);
+			} else if (proxies[id] >= 0) {
+				tree.moveProxy(proxies[id], bounds[id]);
+			} else {
+				// a static object moved, which only costs a rebuild
+				rebuildStatic = true;
+			}
+		}
+
+		objectCount = bounds.size();
+
+		if (rebuildStatic) {
+			std::vector<unsigned int> staticIds;
+			for (unsigned int id = 0; id < objectCount; id++) {
+				if (proxies[id] < 0) {
+					staticIds.push_back(id);
+				}
+			}
+			staticTree.build(bounds, staticIds);
+		}
+	}
+
+	// Calls callback(id) for the objects whose bounds may overlap box, stops early when
+	// the callback returns false. The trees report by fattened or leaf bounds, so they may report more.
+	template <typename Callback>
+	void query(const AABB& box, Callback callback) const {
+		if (broadphase == HASH_GRID) {
+			grid.query(box, callback);
+		} else if (staticTree.query(box, callback)) {
+			tree.query(box, [&](int id) { return callback((unsigned int)id); });
+		}
+	}
+
+	// Objects whose world bounds come within radius of center
+	template <typename Callback>
+	void queryRadius(const glm::vec3& center, float radius, Callback callback) const {
+		if (broadphase == HASH_GRID) {
+			// the grid keeps the bounds of its entries
+			grid.queryRadius(center, radius, callback);
+			return;
+		}
+
+		AABB box(center - glm::vec3(radius), center + glm::vec3(radius));
+		query(box, [&](unsigned int id) {
+			AABB bounds = objects[id].bb.bounds();
+			glm::vec3 offset = glm::min(glm::max(center, bounds.min), bounds.max) - center;
+			if (glm::dot(offset, offset) > radius * radius) {
+				return true;
+			}
+			return callback(id);
+		});
+	}
+
+	// Whether box, moved by positionDelta, intersects any scene object. Objects are tested
+	// by the shape of their primitive, see Collider.
+	bool isColliding(const OBB& box, glm::vec3 positionDelta) const {
+		OBB moved = box.translated(positionDelta);
+		Collider mover = Collider::fromBox(moved);
+		return collides(moved, [&](unsigned int id) { return ColliderTests::intersects(mover, colliders[id]); });
+	}
+
+	// Same test for a mover that is tested again every frame. The axis that separated it from
+	// each nearby object is cached under moverId, so most pairs skip the full SAT.
+	bool isColliding(unsigned int moverId, const OBB& box, glm::vec3 positionDelta) const {
+		OBB moved = box.translated(positionDelta);
+		Collider mover = Collider::fromBox(moved);
+		return collides(moved, [&](unsigned int id) {
+			// the cached box test rejects, the shape test decides for what the box cannot
+			return axisCache.intersects(moverId, moved, id, versions[id], objects[id].bb)
+				&& (colliders[id].type == COLLIDER_BOX || ColliderTests::intersects(mover, colliders[id]));
+		});
+	}
+
+	// Resolves count movers at once on pool, results[i] tells whether movers[i] can move by its
+	// displacement. results must hold count entries. The broadphase is only read, so update()
+	// must not run meanwhile. Movers skip the separating axis cache, which is not shared
+	// between threads, and the last* counters are left alone.
+	void isColliding(const MoverQuery* movers, size_t count, MoverResult* results, ThreadPool& pool) const {
+		pool.parallelFor(count, MOVER_GRAIN, [&](size_t begin, size_t end) {
+			unsigned int candidates = 0, triangleTests = 0;
+			for (size_t i = begin; i < end; i++) {
+				OBB moved = movers[i].box.translated(movers[i].displacement);
+				Collider mover = Collider::fromBox(moved);
+				results[i].object = firstCollision(moved, [&](unsigned int id) {
+					return ColliderTests::intersects(mover, colliders[id]);
+				}, candidates, triangleTests);
+			}
+		});
+	}
+
+	const SeparatingAxisCache& separatingAxisCache() const {
+		return axisCache;
+	}
+
+	void resetSeparatingAxisStats() {
+		axisCache.resetStats();
+	}
+
+	// Closest object the ray hits. Objects built with CPU geometry are hit on their
+	// triangles, the others on their collision box. direction need not be unit length,
+	// distances are measured along it once normalized.
+	RaycastHit raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance = INFINITY) const {
+		Ray ray(origin, glm::normalize(direction), maxDistance);
+		RaycastHit hit;
+		float closest = maxDistance;
+
+		auto test = [&](unsigned int id, float& distance) {
+			testRay(id, ray, distance, hit);
+		};
+
+		if (broadphase == HASH_GRID) {
+			grid.raycast(origin, ray.direction, closest, test);
+		} else {
+			staticTree.raycast(origin, ray.direction, closest, test);
+			tree.raycast(origin, ray.direction, closest, [&](int id, float& distance) { test((unsigned int)id, distance); });
+		}
+
+		return finish(ray, hit);
+	}
+
+	// Casts many rays, hits[i] is the result of rays[i]. As Ray requires, their directions
+	// must be unit length. Only the static tree is walked in packets of RayPacket::WIDTH,
+	// which pays off for coherent rays. The dynamic tree is still walked per ray, and
+	// HASH_GRID casts the rays one at a time.
+	void raycast(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits) const {
+		hits.assign(rays.size(), RaycastHit());
+
+		if (broadphase == HASH_GRID) {
+			for (size_t i = 0; i < rays.size(); i++) {
+				hits[i] = raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance);
+			}
+			return;
+		}
+
+		for (size_t first = 0; first < rays.size(); first += RayPacket::WIDTH) {
+			size_t count = std::min(rays.size() - first, (size_t)RayPacket::WIDTH);
+			RayPacket packet(&rays[first], count);
+
+			staticTree.raycast(packet, [&](unsigned int id, unsigned int mask) {
+				for (int lane = 0; lane < RayPacket::WIDTH; lane++) {
+					if (mask & (1u << lane)) {
+						testRay(id, rays[first + lane], packet.maxDistance[lane], hits[first + lane]);
+					}
+				}
+			});
+
+			for (size_t lane = 0; lane < count; lane++) {
+				const Ray& ray = rays[first + lane];
+				tree.raycast(ray.origin, ray.direction, packet.maxDistance[lane], [&](int id, float& distance) {
+					testRay((unsigned int)id, ray, distance, hits[first + lane]);
+				});
+				hits[first + lane] = finish(ray, hits[first + lane]);
+			}
+		}
+	}
+
+	BroadphaseType broadphaseType() const {
+		return broadphase;
+	}
+
+private:
+	const std::vector<Primitive>& objects;
+	const TransformStore& transforms;
+	BroadphaseType broadphase;
+	size_t objectCount = 0;
+
+	StaticBVH staticTree;
+	DynamicAABBTree tree;
+	std::vector<int> proxies; // tree proxy of each object, -1 for static ones
+	std::vector<unsigned int> versions; // bumped whenever an object moves, invalidates its cached axes
+	mutable SeparatingAxisCache axisCache;
+	std::vector<Collider> colliders;
+
+	Collider collider(unsigned int id) const {
+		const Primitive& object = objects[id];
+		return Collider::fromPrimitive(object.geometryKey, transforms.world[object.transformId], object.bb);
+	}
+	SpatialHashGrid grid;
+
+	// model space rays of every object, and the triangle hierarchies shared by the
+	// objects with the same CPU geometry
+	std::vector<glm::mat4> inverseWorld;
+	std::vector<const MeshBVH*> meshes;
+	std::unordered_map<const MeshGeometry*, std::unique_ptr<MeshBVH>> meshBVHs;
+
+	const MeshBVH* meshBVH(const Primitive& object) {
+		if (object.geometry == nullptr) {
+			return nullptr;
+		}
+
+		std::unique_ptr<MeshBVH>& bvh = meshBVHs[object.geometry.get()];
+		if (bvh == nullptr) {
+			bvh.reset(new MeshBVH(*object.geometry));
+		}
+		return bvh.get();
+	}
+
+	// Common part of the isColliding overloads, shapeTest(id) tests the box against object id.
+	// Only objects whose collider is approximate need their triangles.
+	template <typename ShapeTest>
+	bool collides(const OBB& moved, ShapeTest shapeTest) const {
+		lastCandidates = 0;
+		lastTriangleTests = 0;
+		return firstCollision(moved, shapeTest, lastCandidates, lastTriangleTests) >= 0;
+	}
+
+	// First object shapeTest and the narrow phase find in moved's way, or -1. Only touches
+	// the counters it is given, so it can run on several threads.
+	template <typename ShapeTest>
+	int firstCollision(const OBB& moved, ShapeTest shapeTest, unsigned int& candidates, unsigned int& triangleTests) const {
+		int colliding = -1;
+
+		query(moved.bounds(), [&](unsigned int id) {
+			candidates++;
+			if (shapeTest(id) && (!exactNarrowPhase || !colliders[id].approximate || intersectsMesh(id, moved, triangleTests))) {
+				colliding = id;
+				return false;
+			}
+			return true;
+		});
+
+		return colliding;
+	}
+
+	// Whether box intersects one of the object's triangles or lies inside a closed one,
+	// objects without CPU geometry only have their collision box. Triangles are moved into
+	// the box's frame and tested a TriangleBatch at a time, stopping at the first batch with
+	// an overlap.
+	bool intersectsMesh(unsigned int id, const OBB& box, unsigned int& triangleTests) const {
+		const MeshBVH* mesh = meshes[id];
+		if (mesh == nullptr) {
+			return true;
+		}
+
+		// the box in model space is a parallelepiped under non-uniform scale, but its
+		// transformed extents still bound it exactly
+		AABB localBounds = box.transformed(inverseWorld[id]).bounds();
+
+		const glm::mat4& world = transforms.world[objects[id].transformId];
+		glm::mat3 toBox = glm::transpose(box.rotation) * glm::mat3(world);
+		glm::vec3 offset = (glm::vec3(world[3]) - box.center) * box.rotation;
+
+		TriangleBatch batch;
+		bool hit = false;
+		auto flush = [&]() {
+			triangleTests += batch.count;
+			hit = TriangleBoxKernel::overlapMask(box.halfExtents, batch) != 0;
+			batch.count = 0;
+		};
+
+		mesh->query(localBounds, [&](unsigned int t) {
+			const glm::vec3* corner = mesh->triangle(t);
+			batch.add(toBox * corner[0] + offset, toBox * corner[1] + offset, toBox * corner[2] + offset);
+			if (batch.full()) {
+				flush();
+			}
+			return !hit;
+		});
+
+		if (!hit) {
+			flush();
+		}
+		if (!hit && colliders[id].closed) {
+			// touching no triangle, the box is either all inside or all outside
+			hit = mesh->contains(glm::vec3(inverseWorld[id] * glm::vec4(box.center, 1.0f)));
+		}
+		return hit;
+	}
+
+	// Tests one object, on a hit closer than maxDistance lowers it and fills hit
+	void testRay(unsigned int id, const Ray& ray, float& maxDistance, RaycastHit& hit) const {
+		float distance;
+		glm::vec3 normal;
+		// the mesh's own hierarchy culls the ray, the world box of a distorted object is a
+		// parallelepiped the slab test misjudges, so it could drop the closest hit
+		if (meshes[id] == nullptr && !objects[id].bb.intersectsRay(ray.origin, ray.direction, maxDistance, distance, normal)) {
+			return;
+		}
+
+		if (meshes[id] != nullptr) {
+			// the ray is not renormalized in model space, so distances stay world distances
+			const glm::mat4& inverse = inverseWorld[id];
+			glm::vec3 localOrigin = glm::vec3(inverse * glm::vec4(ray.origin, 1.0f));
+			glm::vec3 localDirection = glm::vec3(inverse * glm::vec4(ray.direction, 0.0f));
+
+			distance = maxDistance;
+			glm::vec3 localNormal;
+			if (!meshes[id]->raycast(localOrigin, localDirection, distance, localNormal)) {
+				return;
+			}
+			normal = glm::normalize(transforms.normal[objects[id].transformId] * localNormal);
+		}
+
+		maxDistance = distance;
+		hit.object = id;
+		hit.distance = distance;
+		hit.normal = normal;
+	}
+
+	static RaycastHit finish(const Ray& ray, RaycastHit hit) {
+		if (hit.hit()) {
+			hit.point = ray.origin + ray.direction * hit.distance;
+		}
+		return hit;
+	}
+};
+
+#endif
@@ -0,0 +1,344 @@
+#ifndef DYNAMICAABBTREE_H
+#define DYNAMICAABBTREE_H
+
+#include "../Spatial/AABB.cpp"
+
+#include <algorithm>
+#include <vector>
+
+struct TreeNode {
+	AABB box;
+	int parent = -1;
+	int left = -1, right = -1; // -1 for leaves
+	int height = 0;            // 0 for leaves, -1 for free nodes
+	int userData = -1;         // the object a leaf stands for
+
+	bool isLeaf() const {
+		return left < 0;
+	}
+};
+
+// Balanced binary tree of fattened AABBs that supports inserting, removing and moving
+// boxes, so it stays valid for moving objects without being rebuilt. Leaves store a box
+// grown by MARGIN, small movements inside it do not touch the tree at all.
+// Insertion picks the sibling that grows the tree's surface area the least and rotations
+// keep the height logarithmic, so queries cost O(log n) plus the number of hits.
+class DynamicAABBTree {
+
+public:
+	static constexpr float MARGIN = 0.1f;
+
+	int createProxy(const AABB& box, int userData) {
+		int proxy = allocateNode();
+		nodes[proxy].box = fatten(box);
+		nodes[proxy].userData = userData;
+		nodes[proxy].height = 0;
+		insertLeaf(proxy);
+		proxyCount++;
+		return proxy;
+	}
+
+	void destroyProxy(int proxy) {
+		removeLeaf(proxy);
+		freeNode(proxy);
+		proxyCount--;
+	}
+
+	// Returns true when the box left its fat box and the proxy was reinserted
+	bool moveProxy(int proxy, const AABB& box) {
+		if (nodes[proxy].box.contains(box)) {
+			return false;
+		}
+
+		removeLeaf(proxy);
+		nodes[proxy].box = fatten(box);
+		insertLeaf(proxy);
+		return true;
+	}
+
+	// Calls callback(userData) for every proxy whose fat box overlaps box,
+	// stops early when the callback returns false.
+	template <typename Callback>
+	void query(const AABB& box, Callback callback) const {
+		if (root < 0) {
+			return;
+		}
+
+		NodeStack stack(height() + 2);
+		stack.push(root);
+
+		while (!stack.empty()) {
+			const TreeNode& node = nodes[stack.pop()];
+
+			if (!node.box.overlaps(box)) {
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				if (!callback(node.userData)) {
+					return;
+				}
+			} else {
+				stack.push(node.left);
+				stack.push(node.right);
+			}
+		}
+	}
+
+	// Calls hit(userData, maxDistance) for the proxies whose fat box the ray passes through,
+	// hit lowers maxDistance when it finds a closer hit
+	template <typename Hit>
+	void raycast(const glm::vec3& origin, const glm::vec3& direction, float& maxDistance, Hit hit) const {
+		if (root < 0) {
+			return;
+		}
+
+		glm::vec3 inverseDirection = 1.0f / direction;
+		NodeStack stack(height() + 2);
+		stack.push(root);
+
+		while (!stack.empty()) {
+			const TreeNode& node = nodes[stack.pop()];
+
+			float distance;
+			if (!node.box.intersectsRay(origin, inverseDirection, maxDistance, distance)) {
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				hit(node.userData, maxDistance);
+			} else {
+				stack.push(node.left);
+				stack.push(node.right);
+			}
+		}
+	}
+
+	const AABB& getFatAABB(int proxy) const {
+		return nodes[proxy].box;
+	}
+
+	int height() const {
+		return root < 0 ? 0 : nodes[root].height;
+	}
+
+	size_t size() const {
+		return proxyCount;
+	}
+
+private:
+	std::vector<TreeNode> nodes;
+	int root = -1;
+	int freeList = -1;
+	size_t proxyCount = 0;
+
+	// Traversal stack on the caller's stack, so queries can run on several threads at once.
+	// A depth first walk holds at most height + 1 nodes, only very deep trees use the heap.
+	struct NodeStack {
+		static const int FIXED_SIZE = 64;
+		int fixed[FIXED_SIZE];
+		std::vector<int> heap;
+		int* data = fixed;
+		int top = 0;
+
+		explicit NodeStack(int capacity) {
+			if (capacity > FIXED_SIZE) {
+				heap.resize(capacity);
+				data = heap.data();
+			}
+		}
+
+		void push(int node) { data[top++] = node; }
+		int pop() { return data[--top]; }
+		bool empty() const { return top == 0; }
+	};
+
+	static AABB fatten(const AABB& box) {
+		glm::vec3 margin(MARGIN);
+		return AABB(box.min - margin, box.max + margin);
+	}
+
+	// Free nodes are chained through their parent index
+	int allocateNode() {
+		if (freeList < 0) {
+			nodes.push_back(TreeNode());
+			return nodes.size() - 1;
+		}
+
+		int index = freeList;
+		freeList = nodes[index].parent;
+		nodes[index] = TreeNode();
+		return index;
+	}
+
+	void freeNode(int index) {
+		nodes[index].parent = freeList;
+		nodes[index].height = -1;
+		freeList = index;
+	}
+
+	void insertLeaf(int leaf) {
+		if (root < 0) {
+			root = leaf;
+			nodes[leaf].parent = -1;
+			return;
+		}
+
+		// descend towards the sibling with the lowest cost of adding the leaf
+		AABB leafBox = nodes[leaf].box;
+		int index = root;
+		while (!nodes[index].isLeaf()) {
+			int left = nodes[index].left;
+			int right = nodes[index].right;
+
+			float area = nodes[index].box.surfaceArea();
+			float combinedArea = AABB::merge(nodes[index].box, leafBox).surfaceArea();
+
+			// cost of making a new parent for this node and the leaf
+			float cost = 2.0f * combinedArea;
+			// every node below here grows by at least this much
+			float inheritanceCost = 2.0f * (combinedArea - area);
+
+			float costLeft = descendCost(left, leafBox) + inheritanceCost;
+			float costRight = descendCost(right, leafBox) + inheritanceCost;
+
+			if (cost < costLeft && cost < costRight) {
+				break;
+			}
+
+			index = costLeft < costRight ? left : right;
+		}
+
+		int sibling = index;
+		int oldParent = nodes[sibling].parent;
+		int newParent = allocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].box = AABB::merge(leafBox, nodes[sibling].box);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].left = sibling;
+		nodes[newParent].right = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		if (oldParent < 0) {
+			root = newParent;
+		} else if (nodes[oldParent].left == sibling) {
+			nodes[oldParent].left = newParent;
+		} else {
+			nodes[oldParent].right = newParent;
+		}
+
+		refitAncestors(nodes[leaf].parent);
+	}
+
+	float descendCost(int child, const AABB& leafBox) const {
+		float combined = AABB::merge(leafBox, nodes[child].box).surfaceArea();
+		if (nodes[child].isLeaf()) {
+			return combined;
+		}
+		return combined - nodes[child].box.surfaceArea();
+	}
+
+	void removeLeaf(int leaf) {
+		if (leaf == root) {
+			root = -1;
+			return;
+		}
+
+		int parent = nodes[leaf].parent;
+		int grandParent = nodes[parent].parent;
+		int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+		if (grandParent < 0) {
+			root = sibling;
+			nodes[sibling].parent = -1;
+			freeNode(parent);
+			return;
+		}
+
+		if (nodes[grandParent].left == parent) {
+			nodes[grandParent].left = sibling;
+		} else {
+			nodes[grandParent].right = sibling;
+		}
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+
+		refitAncestors(grandParent);
+	}
+
+	// Rebalances and recomputes the boxes and heights from index up to the root
+	void refitAncestors(int index) {
+		while (index >= 0) {
+			index = balance(index);
+
+			int left = nodes[index].left;
+			int right = nodes[index].right;
+			nodes[index].height = 1 + std::max(nodes[left].height, nodes[right].height);
+			nodes[index].box = AABB::merge(nodes[left].box, nodes[right].box);
+
+			index = nodes[index].parent;
+		}
+	}
+
+	// Rotates the taller child of a up if the children's heights differ by more than one,
+	// returns the node that took a's place.
+	int balance(int a) {
+		if (nodes[a].isLeaf() || nodes[a].height < 2) {
+			return a;
+		}
+
+		int b = nodes[a].left;
+		int c = nodes[a].right;
+		int difference = nodes[c].height - nodes[b].height;
+
+		if (difference > 1) {
+			return rotateUp(a, c, b, false);
+		}
+		if (difference < -1) {
+			return rotateUp(a, b, c, true);
+		}
+
+		return a;
+	}
+
+	// Makes child the parent of a. The taller grandchild stays under child, the other one
+	// replaces child under a. wasLeft tells which side of a child was on.
+	int rotateUp(int a, int child, int other, bool wasLeft) {
+		int f = nodes[child].left;
+		int g = nodes[child].right;
+
+		nodes[child].left = a;
+		nodes[child].parent = nodes[a].parent;
+		nodes[a].parent = child;
+
+		int parent = nodes[child].parent;
+		if (parent < 0) {
+			root = child;
+		} else if (nodes[parent].left == a) {
+			nodes[parent].left = child;
+		} else {
+			nodes[parent].right = child;
+		}
+
+		int keep = nodes[f].height > nodes[g].height ? f : g;
+		int move = keep == f ? g : f;
+
+		nodes[child].right = keep;
+		if (wasLeft) {
+			nodes[a].left = move;
+		} else {
+			nodes[a].right = move;
+		}
+		nodes[move].parent = a;
+
+		nodes[a].box = AABB::merge(nodes[other].box, nodes[move].box);
+		nodes[a].height = 1 + std::max(nodes[other].height, nodes[move].height);
+		nodes[child].box = AABB::merge(nodes[a].box, nodes[keep].box);
+		nodes[child].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+
+		return child;
+	}
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef MESHBVH_H
+#define MESHBVH_H
+
+#include "../Primitives/Mesh.cpp"
+#include "../Spatial/StaticBVH.cpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+
+// Triangles of a mesh in model space with a StaticBVH over them, for exact ray and
+// overlap queries. Built once from a primitive's CPU geometry and shared by every
+// object using that geometry.
+class MeshBVH {
+
+public:
+	explicit MeshBVH(const MeshGeometry& geometry) {
+		const std::vector<float>& vertices = geometry.vertices;
+		auto position = [&](unsigned int vertex) {
+			return glm::vec3(vertices[vertex * 8], vertices[vertex * 8 + 1], vertices[vertex * 8 + 2]);
+		};
+
+		// unindexed meshes list their triangles' vertices in order
+		size_t count = geometry.indices.empty() ? vertices.size() / 8 : geometry.indices.size();
+		corners.reserve(count);
+		for (size_t i = 0; i + 2 < count; i += 3) {
+			for (int k = 0; k < 3; k++) {
+				corners.push_back(position(geometry.indices.empty() ? i + k : geometry.indices[i + k]));
+			}
+		}
+
+		std::vector<AABB> bounds(triangleCount());
+		std::vector<unsigned int> ids(triangleCount());
+		for (unsigned int t = 0; t < triangleCount(); t++) {
+			bounds[t].expand(corners[t * 3]);
+			bounds[t].expand(corners[t * 3 + 1]);
+			bounds[t].expand(corners[t * 3 + 2]);
+			ids[t] = t;
+		}
+		tree.build(bounds, ids);
+	}
+
+	// Closest triangle the ray hits before maxDistance, which is lowered to its distance.
+	// normal is the triangle's model space normal, facing the ray.
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, float& maxDistance, glm::vec3& normal) const {
+		int closest = -1;
+		tree.raycast(origin, direction, maxDistance, [&](unsigned int t, float& distance) {
+			float hit;
+			if (intersectTriangle(t, origin, direction, distance, hit)) {
+				distance = hit;
+				closest = t;
+			}
+		});
+
+		if (closest < 0) {
+			return false;
+		}
+
+		const glm::vec3* v = &corners[closest * 3];
+		normal = glm::normalize(glm::cross(v[1] - v[0], v[2] - v[0]));
+		if (glm::dot(normal, direction) > 0.0f) {
+			normal = -normal;
+		}
+		return true;
+	}
+
+	// Whether point lies inside the mesh, by the parity of the triangles a ray from it
+	// crosses. Only meaningful for closed meshes. The ray's direction is skewed so that it
+	// is unlikely to run through the shared edges of axis aligned or symmetric meshes.
+	bool contains(const glm::vec3& point) const {
+		const glm::vec3 direction = glm::normalize(glm::vec3(0.5377f, 0.8116f, 0.2283f));
+		float maxDistance = INFINITY;
+		unsigned int crossings = 0;
+		tree.raycast(point, direction, maxDistance, [&](unsigned int t, float& distance) {
+			float hit;
+			crossings += intersectTriangle(t, point, direction, distance, hit);
+		});
+		return crossings % 2 == 1;
+	}
+
+	// Calls callback(triangle) for the triangles in leaves overlapping box, stops early
+	// when it returns false
+	template <typename Callback>
+	bool query(const AABB& box, Callback callback) const {
+		return tree.query(box, callback);
+	}
+
+	// The three corners of triangle t
+	const glm::vec3* triangle(unsigned int t) const {
+		return &corners[t * 3];
+	}
+
+	unsigned int triangleCount() const {
+		return corners.size() / 3;
+	}
+
+	size_t memoryUsage() const {
+		return corners.capacity() * sizeof(glm::vec3) + tree.memoryUsage();
+	}
+
+private:
+	std::vector<glm::vec3> corners;
+	StaticBVH tree;
+
+	// Moller-Trumbore, both faces of the triangle count
+	bool intersectTriangle(unsigned int t, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const {
+		const glm::vec3* corner = &corners[t * 3];
+		glm::vec3 edge1 = corner[1] - corner[0];
+		glm::vec3 edge2 = corner[2] - corner[0];
+
+		glm::vec3 p = glm::cross(direction, edge2);
+		float determinant = glm::dot(edge1, p);
+		if (std::fabs(determinant) < 1e-12f) {
+			return false;
+		}
+		float inverse = 1.0f / determinant;
+
+		glm::vec3 s = origin - corner[0];
+		float u = glm::dot(s, p) * inverse;
+		if (u < 0.0f || u > 1.0f) {
+			return false;
+		}
+
+		glm::vec3 q = glm::cross(s, edge1);
+		float v = glm::dot(direction, q) * inverse;
+		if (v < 0.0f || u + v > 1.0f) {
+			return false;
+		}
+
+		distance = glm::dot(edge2, q) * inverse;
+		return distance >= 0.0f && distance <= maxDistance;
+	}
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef OBBKERNEL_H
+#define OBBKERNEL_H
+
+#include "../Spatial/OBB.cpp"
+#include "../Spatial/FloatPack.cpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Oriented boxes stored as separate arrays of centers, half extents and unit axes, so that
+// one box can be tested against many of them a SIMD register at a time. The arrays are
+// padded to a multiple of LANES with empty boxes whose result bits are cleared.
+struct OBBSet {
+	static const unsigned int LANES = 8;
+
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	// axis[i * 3 + j] is component j of axis i
+	std::vector<float> axis[9];
+
+	size_t size() const {
+		return count;
+	}
+
+	void clear() {
+		count = 0;
+		resizeArrays(0);
+	}
+
+	void add(const OBB& box) {
+		size_t index = count++;
+		resizeArrays((count + LANES - 1) / LANES * LANES);
+
+		centerX[index] = box.center.x; centerY[index] = box.center.y; centerZ[index] = box.center.z;
+		extentX[index] = box.halfExtents.x; extentY[index] = box.halfExtents.y; extentZ[index] = box.halfExtents.z;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				axis[i * 3 + j][index] = box.rotation[i][j];
+			}
+		}
+	}
+
+private:
+	size_t count = 0;
+
+	void resizeArrays(size_t padded) {
+		std::vector<float>* arrays[] = { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ };
+		for (std::vector<float>* array : arrays) {
+			array->resize(padded, 0.0f);
+		}
+		for (int i = 0; i < 9; i++) {
+			axis[i].resize(padded, 0.0f);
+		}
+	}
+};
+
+// Tests one oriented box against every box of a set with the same separating axis test
+// as OBB::intersects. Bit i of the result is set when box i overlaps the query box,
+// mask holds one bit per box in 64 bit words.
+class OBBKernel {
+
+public:
+	static void overlapMask(const OBB& query, const OBBSet& set, std::vector<uint64_t>& mask) {
+		run<FloatPack>(query, set, mask);
+	}
+
+	// Same test without SIMD, for comparison and for platforms without SSE2
+	static void overlapMaskScalar(const OBB& query, const OBBSet& set, std::vector<uint64_t>& mask) {
+		run<ScalarPack>(query, set, mask);
+	}
+
+	static bool isSet(const std::vector<uint64_t>& mask, size_t index) {
+		return (mask[index / 64] >> (index % 64)) & 1;
+	}
+
+private:
+	template <typename Pack>
+	static void run(const OBB& query, const OBBSet& set, std::vector<uint64_t>& mask) {
+		size_t count = set.size();
+		mask.assign((count + 63) / 64, 0);
+
+		Pack a[3][3];
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				a[i][j] = Pack::set(query.rotation[i][j]);
+			}
+		}
+		Pack e0 = Pack::set(query.halfExtents.x), e1 = Pack::set(query.halfExtents.y), e2 = Pack::set(query.halfExtents.z);
+		Pack cx = Pack::set(query.center.x), cy = Pack::set(query.center.y), cz = Pack::set(query.center.z);
+		Pack epsilon = Pack::set(OBB::EPSILON);
+
+		for (size_t k = 0; k < count; k += Pack::WIDTH) {
+			Pack b[3][3];
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					b[i][j] = Pack::load(&set.axis[i * 3 + j][k]);
+				}
+			}
+			Pack f0 = Pack::load(&set.extentX[k]), f1 = Pack::load(&set.extentY[k]), f2 = Pack::load(&set.extentZ[k]);
+
+			// rotation of b expressed in a's frame and its absolute value
+			Pack R[3][3], AR[3][3];
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					R[i][j] = a[i][0] * b[j][0] + a[i][1] * b[j][1] + a[i][2] * b[j][2];
+					AR[i][j] = Pack::abs(R[i][j]) + epsilon;
+				}
+			}
+
+			// translation in a's frame
+			Pack dx = Pack::load(&set.centerX[k]) - cx;
+			Pack dy = Pack::load(&set.centerY[k]) - cy;
+			Pack dz = Pack::load(&set.centerZ[k]) - cz;
+			Pack t[3];
+			for (int i = 0; i < 3; i++) {
+				t[i] = dx * a[i][0] + dy * a[i][1] + dz * a[i][2];
+			}
+
+			Pack e[3] = { e0, e1, e2 };
+			Pack f[3] = { f0, f1, f2 };
+
+			// a lane is separated as soon as one axis separates it
+			unsigned int separated = 0;
+
+			// a's face axes
+			for (int i = 0; i < 3; i++) {
+				Pack rb = f0 * AR[i][0] + f1 * AR[i][1] + f2 * AR[i][2];
+				separated |= Pack::greater(Pack::abs(t[i]), e[i] + rb);
+			}
+
+			// b's face axes
+			for (int j = 0; j < 3; j++) {
+				Pack ra = e0 * AR[0][j] + e1 * AR[1][j] + e2 * AR[2][j];
+				Pack distance = t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j];
+				separated |= Pack::greater(Pack::abs(distance), ra + f[j]);
+			}
+
+			// cross products of a's axis i with b's axis j
+			for (int i = 0; i < 3; i++) {
+				int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+				for (int j = 0; j < 3; j++) {
+					int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+					Pack ra = e[i1] * AR[i2][j] + e[i2] * AR[i1][j];
+					Pack rb = f[j1] * AR[i][j2] + f[j2] * AR[i][j1];
+					Pack distance = t[i2] * R[i1][j] - t[i1] * R[i2][j];
+					separated |= Pack::greater(Pack::abs(distance), ra + rb);
+				}
+			}
+
+			unsigned int overlapping = ~separated & ((1u << Pack::WIDTH) - 1);
+			mask[k / 64] |= (uint64_t)overlapping << (k % 64);
+		}
+
+		// padding lanes are empty boxes at the origin, clear whatever they reported
+		if (count % 64 != 0) {
+			mask.back() &= (~0ull) >> (64 - count % 64);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef SPATIALHASHGRID_H
+#define SPATIALHASHGRID_H
+
+#include "../Spatial/AABB.cpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid of cubic cells, hashed so that only occupied cells take memory. Every object
+// is listed in each cell its bounds touch. Suits scenes of many objects of about the cell
+// size, e.g. wall pieces, where it needs no balancing and moves are O(1).
+class SpatialHashGrid {
+
+public:
+	explicit SpatialHashGrid(float cellSize = 2.0f) : cellSize(cellSize), inverseCellSize(1.0f / cellSize) {}
+
+	float getCellSize() const {
+		return cellSize;
+	}
+
+	void insert(unsigned int id, const AABB& box) {
+		if (id >= entries.size()) {
+			entries.resize(id + 1);
+		}
+
+		Entry& entry = entries[id];
+		entry.box = box;
+		entry.present = true;
+		cellRange(box, entry.cellMin, entry.cellMax);
+		addToCells(id, entry);
+		objectCount++;
+	}
+
+	void remove(unsigned int id) {
+		if (id >= entries.size() || !entries[id].present) {
+			return;
+		}
+
+		removeFromCells(id, entries[id]);
+		entries[id].present = false;
+		objectCount--;
+	}
+
+	// Only touches the cells when the object crossed into other cells
+	void move(unsigned int id, const AABB& box) {
+		if (id >= entries.size() || !entries[id].present) {
+			insert(id, box);
+			return;
+		}
+
+		Entry& entry = entries[id];
+		int cellMin[3], cellMax[3];
+		cellRange(box, cellMin, cellMax);
+		entry.box = box;
+
+		if (sameRange(cellMin, cellMax, entry.cellMin, entry.cellMax)) {
+			return;
+		}
+
+		removeFromCells(id, entry);
+		for (int i = 0; i < 3; i++) {
+			entry.cellMin[i] = cellMin[i];
+			entry.cellMax[i] = cellMax[i];
+		}
+		addToCells(id, entry);
+	}
+
+	// Calls callback(id) once for every object whose bounds overlap box, stops early when the
+	// callback returns false. Keeps no state, so several threads may query at once.
+	template <typename Callback>
+	void query(const AABB& box, Callback callback) const {
+		int queryMin[3], queryMax[3];
+		cellRange(box, queryMin, queryMax);
+
+		if (scanIsCheaper(queryMin, queryMax)) {
+			for (unsigned int id = 0; id < entries.size(); id++) {
+				if (entries[id].present && entries[id].box.overlaps(box) && !callback(id)) {
+					return;
+				}
+			}
+			return;
+		}
+
+		for (int x = queryMin[0]; x <= queryMax[0]; x++) {
+			for (int y = queryMin[1]; y <= queryMax[1]; y++) {
+				for (int z = queryMin[2]; z <= queryMax[2]; z++) {
+					auto cell = cells.find(key(x, y, z));
+					if (cell == cells.end()) {
+						continue;
+					}
+
+					for (unsigned int id : cell->second) {
+						const Entry& entry = entries[id];
+						// an object shared by several visited cells is only reported by the
+						// first of them, the one at the low corner of the overlapping range
+						if (x != std::max(entry.cellMin[0], queryMin[0]) ||
+							y != std::max(entry.cellMin[1], queryMin[1]) ||
+							z != std::max(entry.cellMin[2], queryMin[2])) {
+							continue;
+						}
+
+						if (entry.box.overlaps(box) && !callback(id)) {
+							return;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Walks the cells along the ray front to back (Amanatides and Woo's 3D DDA) and calls
+	// hit(id, maxDistance) for the objects listed in them. hit lowers maxDistance on a hit,
+	// the walk stops once the cells reach past it or leave the occupied range, so unbounded
+	// rays end at the last occupied cell. An object spanning several cells of the walk is
+	// reported once per cell.
+	template <typename Hit>
+	void raycast(const glm::vec3& origin, const glm::vec3& direction, float& maxDistance, Hit hit) const {
+		if (cells.empty()) {
+			return;
+		}
+
+		// clip the ray to the box of the occupied cells
+		float enter = 0.0f, exit = maxDistance;
+		for (int i = 0; i < 3; i++) {
+			float low = occupiedMin[i] * cellSize, high = (occupiedMax[i] + 1) * cellSize;
+			if (direction[i] == 0.0f) {
+				if (origin[i] < low || origin[i] > high) {
+					return;
+				}
+				continue;
+			}
+			float t1 = (low - origin[i]) / direction[i], t2 = (high - origin[i]) / direction[i];
+			enter = std::max(enter, std::min(t1, t2));
+			exit = std::min(exit, std::max(t1, t2));
+		}
+		if (enter > exit) {
+			return;
+		}
+
+		glm::vec3 start = origin + direction * enter;
+		int cell[3], step[3];
+		float next[3], delta[3];
+		for (int i = 0; i < 3; i++) {
+			cell[i] = std::min(std::max((int)std::floor(start[i] * inverseCellSize), occupiedMin[i]), occupiedMax[i]);
+			if (direction[i] > 0.0f) {
+				step[i] = 1;
+				next[i] = enter + ((cell[i] + 1) * cellSize - start[i]) / direction[i];
+				delta[i] = cellSize / direction[i];
+			} else if (direction[i] < 0.0f) {
+				step[i] = -1;
+				next[i] = enter + (cell[i] * cellSize - start[i]) / direction[i];
+				delta[i] = -cellSize / direction[i];
+			} else {
+				step[i] = 0;
+				next[i] = INFINITY;
+				delta[i] = INFINITY;
+			}
+		}
+
+		while (true) {
+			auto found = cells.find(key(cell[0], cell[1], cell[2]));
+			if (found != cells.end()) {
+				for (unsigned int id : found->second) {
+					hit(id, maxDistance);
+				}
+			}
+
+			// every point of the ray before the cell's exit has been covered
+			int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+			if (next[axis] >= std::min(exit, maxDistance)) {
+				return;
+			}
+
+			cell[axis] += step[axis];
+			next[axis] += delta[axis];
+			if (cell[axis] < occupiedMin[axis] || cell[axis] > occupiedMax[axis]) {
+				return;
+			}
+		}
+	}
+
+	// Objects whose bounds come within radius of center
+	template <typename Callback>
+	void queryRadius(const glm::vec3& center, float radius, Callback callback) const {
+		auto within = [&](unsigned int id) {
+			const AABB& bounds = entries[id].box;
+			glm::vec3 closest = glm::min(glm::max(center, bounds.min), bounds.max);
+			glm::vec3 offset = closest - center;
+			return glm::dot(offset, offset) <= radius * radius;
+		};
+
+		// the scan only needs the distance test, the box test of query's scan would be extra
+		AABB box(center - glm::vec3(radius), center + glm::vec3(radius));
+		int queryMin[3], queryMax[3];
+		cellRange(box, queryMin, queryMax);
+		if (scanIsCheaper(queryMin, queryMax)) {
+			for (unsigned int id = 0; id < entries.size(); id++) {
+				if (entries[id].present && within(id) && !callback(id)) {
+					return;
+				}
+			}
+			return;
+		}
+
+		query(box, [&](unsigned int id) {
+			return !within(id) || callback(id);
+		});
+	}
+
+	size_t size() const {
+		return objectCount;
+	}
+
+	size_t occupiedCells() const {
+		return cells.size();
+	}
+
+private:
+	// A cell lookup costs about as much as testing this many boxes in a scan (measured with
+	// SpatialHashGrid benchmark, ~100 ns per hashed cell against ~3 ns per box)
+	static const int CELL_LOOKUP_COST = 32;
+
+	struct Entry {
+		AABB box;
+		int cellMin[3] = { 0, 0, 0 };
+		int cellMax[3] = { 0, 0, 0 };
+		bool present = false;
+	};
+
+	float cellSize;
+	float inverseCellSize;
+	std::vector<Entry> entries;
+	size_t objectCount = 0;
+	std::unordered_map<uint64_t, std::vector<unsigned int>> cells;
+
+	// cell range every object ever inserted lies in, it only grows
+	int occupiedMin[3] = { INT_MAX, INT_MAX, INT_MAX };
+	int occupiedMax[3] = { INT_MIN, INT_MIN, INT_MIN };
+
+	// 21 bits per axis, cells up to a million cell sizes from the origin are distinct
+	static uint64_t key(int x, int y, int z) {
+		const uint64_t mask = (1ull << 21) - 1;
+		return ((uint64_t)x & mask) | (((uint64_t)y & mask) << 21) | (((uint64_t)z & mask) << 42);
+	}
+
+	void cellRange(const AABB& box, int cellMin[3], int cellMax[3]) const {
+		for (int i = 0; i < 3; i++) {
+			cellMin[i] = (int)std::floor(box.min[i] * inverseCellSize);
+			cellMax[i] = (int)std::floor(box.max[i] * inverseCellSize);
+		}
+	}
+
+	// Whether looking up the cells of a query costs more than testing every object
+	bool scanIsCheaper(const int queryMin[3], const int queryMax[3]) const {
+		double cellCount = 1.0;
+		for (int i = 0; i < 3; i++) {
+			cellCount *= (double)queryMax[i] - queryMin[i] + 1;
+		}
+		return cellCount * CELL_LOOKUP_COST > (double)objectCount;
+	}
+
+	static bool sameRange(const int minA[3], const int maxA[3], const int minB[3], const int maxB[3]) {
+		for (int i = 0; i < 3; i++) {
+			if (minA[i] != minB[i] || maxA[i] != maxB[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void addToCells(unsigned int id, const Entry& entry) {
+		for (int i = 0; i < 3; i++) {
+			occupiedMin[i] = std::min(occupiedMin[i], entry.cellMin[i]);
+			occupiedMax[i] = std::max(occupiedMax[i], entry.cellMax[i]);
+		}
+		for (int x = entry.cellMin[0]; x <= entry.cellMax[0]; x++) {
+			for (int y = entry.cellMin[1]; y <= entry.cellMax[1]; y++) {
+				for (int z = entry.cellMin[2]; z <= entry.cellMax[2]; z++) {
+					cells[key(x, y, z)].push_back(id);
+				}
+			}
+		}
+	}
+
+	void removeFromCells(unsigned int id, const Entry& entry) {
+		for (int x = entry.cellMin[0]; x <= entry.cellMax[0]; x++) {
+			for (int y = entry.cellMin[1]; y <= entry.cellMax[1]; y++) {
+				for (int z = entry.cellMin[2]; z <= entry.cellMax[2]; z++) {
+					auto cell = cells.find(key(x, y, z));
+					if (cell == cells.end()) {
+						continue;
+					}
+
+					std::vector<unsigned int>& ids = cell->second;
+					for (size_t i = 0; i < ids.size(); i++) {
+						if (ids[i] == id) {
+							ids[i] = ids.back();
+							ids.pop_back();
+							break;
+						}
+					}
+					if (ids.empty()) {
+						cells.erase(cell);
+					}
+				}
+			}
+		}
+	}
+};
+
+#endif
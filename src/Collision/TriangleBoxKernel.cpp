@@ -0,0 +1,126 @@
+#ifndef TRIANGLEBOXKERNEL_H
+#define TRIANGLEBOXKERNEL_H
+
+#include "../Spatial/FloatPack.cpp"
+
+#include <glm/glm.hpp>
+
+// Up to FloatPack::WIDTH triangles, already moved into the frame of the box they are
+// tested against. x[k][lane] is the x coordinate of corner k of the lane's triangle.
+struct TriangleBatch {
+	static const int WIDTH = FloatPack::WIDTH;
+
+	float x[3][WIDTH], y[3][WIDTH], z[3][WIDTH];
+	int count = 0;
+
+	bool full() const {
+		return count == WIDTH;
+	}
+
+	void add(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+		const glm::vec3 corners[3] = { a, b, c };
+		for (int k = 0; k < 3; k++) {
+			x[k][count] = corners[k].x;
+			y[k][count] = corners[k].y;
+			z[k][count] = corners[k].z;
+		}
+		count++;
+	}
+};
+
+// Triangle against box overlap test of Akenine-Moller: the box's 3 face axes, the triangle
+// normal and the 9 cross products of box axes and triangle edges, for a whole batch at once.
+// The box is centered at the origin and aligned with the axes of the batch's frame.
+class TriangleBoxKernel {
+
+public:
+	// Bit i is set when triangle i of the batch overlaps the box
+	static unsigned int overlapMask(const glm::vec3& halfExtents, TriangleBatch& batch) {
+		return run<FloatPack>(halfExtents, batch);
+	}
+
+	static unsigned int overlapMaskScalar(const glm::vec3& halfExtents, TriangleBatch& batch) {
+		return run<ScalarPack>(halfExtents, batch);
+	}
+
+private:
+	template <typename Pack>
+	static unsigned int run(const glm::vec3& halfExtents, TriangleBatch& batch) {
+		if (batch.count == 0) {
+			return 0;
+		}
+
+		// unused lanes repeat the last triangle, their bits are cleared below
+		for (int lane = batch.count; lane < TriangleBatch::WIDTH; lane++) {
+			for (int k = 0; k < 3; k++) {
+				batch.x[k][lane] = batch.x[k][batch.count - 1];
+				batch.y[k][lane] = batch.y[k][batch.count - 1];
+				batch.z[k][lane] = batch.z[k][batch.count - 1];
+			}
+		}
+
+		Pack hx = Pack::set(halfExtents.x), hy = Pack::set(halfExtents.y), hz = Pack::set(halfExtents.z);
+		Pack zero = Pack::set(0.0f);
+
+		unsigned int overlapping = 0;
+		for (int first = 0; first < batch.count; first += Pack::WIDTH) {
+			Pack x[3], y[3], z[3];
+			for (int k = 0; k < 3; k++) {
+				x[k] = Pack::load(&batch.x[k][first]);
+				y[k] = Pack::load(&batch.y[k][first]);
+				z[k] = Pack::load(&batch.z[k][first]);
+			}
+
+			unsigned int separated = 0;
+
+			// a set of projections separates when it lies entirely beyond the box's radius r
+			auto separates = [&](Pack p0, Pack p1, Pack p2, Pack r) {
+				Pack low = Pack::min(p0, Pack::min(p1, p2));
+				Pack high = Pack::max(p0, Pack::max(p1, p2));
+				return Pack::greater(low, r) | Pack::greater(zero - r, high);
+			};
+
+			// the box's face axes
+			separated |= separates(x[0], x[1], x[2], hx);
+			separated |= separates(y[0], y[1], y[2], hy);
+			separated |= separates(z[0], z[1], z[2], hz);
+
+			Pack ex[3], ey[3], ez[3];
+			for (int k = 0; k < 3; k++) {
+				int next = (k + 1) % 3;
+				ex[k] = x[next] - x[k];
+				ey[k] = y[next] - y[k];
+				ez[k] = z[next] - z[k];
+			}
+
+			// the triangle's normal, all corners project to the same distance on it
+			Pack nx = ey[0] * ez[1] - ez[0] * ey[1];
+			Pack ny = ez[0] * ex[1] - ex[0] * ez[1];
+			Pack nz = ex[0] * ey[1] - ey[0] * ex[1];
+			Pack d = nx * x[0] + ny * y[0] + nz * z[0];
+			Pack r = hx * Pack::abs(nx) + hy * Pack::abs(ny) + hz * Pack::abs(nz);
+			separated |= Pack::greater(Pack::abs(d), r);
+
+			// box axis cross triangle edge
+			for (int k = 0; k < 3; k++) {
+				Pack ax = Pack::abs(ex[k]), ay = Pack::abs(ey[k]), az = Pack::abs(ez[k]);
+
+				// x cross e = (0, -ez, ey)
+				separated |= separates(ey[k] * z[0] - ez[k] * y[0], ey[k] * z[1] - ez[k] * y[1], ey[k] * z[2] - ez[k] * y[2],
+					hy * az + hz * ay);
+				// y cross e = (ez, 0, -ex)
+				separated |= separates(ez[k] * x[0] - ex[k] * z[0], ez[k] * x[1] - ex[k] * z[1], ez[k] * x[2] - ex[k] * z[2],
+					hx * az + hz * ax);
+				// z cross e = (-ey, ex, 0)
+				separated |= separates(ex[k] * y[0] - ey[k] * x[0], ex[k] * y[1] - ey[k] * x[1], ex[k] * y[2] - ey[k] * x[2],
+					hx * ay + hy * ax);
+			}
+
+			overlapping |= (~separated & ((1u << Pack::WIDTH) - 1)) << first;
+		}
+
+		return overlapping & ((1u << batch.count) - 1);
+	}
+};
+
+#endif
@@ -22,57 +22,47 @@ public:
 			return;
 		}
 
-		vertices = getVertices();
-        calculateBoundingBox(vertices, 8);
-        TransferDataToGPU(vertices, bb.vertices);
+		loadGeometry(GeometryKey(CIRCLE, {center.x, center.y, r, (float)steps}), vertexFormat.withoutNormals(), 
+			[this](std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+				getVertices(vertices, indices);
+			});
 	}
 
-private:
-    std::vector<float> getVertices() {
-        std::vector<float> vertices;
-
+public:
+    // The center vertex is shared by every segment and each rim vertex by its two neighbours.
+    void getVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices) {
         float angleStep = 2.0f * M_PI / steps;
 
-        for (int i = 0; i < steps; ++i) {
-            float theta1 = i * angleStep;
-            float theta2 = (i + 1) * angleStep;
-
-            vertices.push_back(center.x);
-            vertices.push_back(center.y);
-            vertices.push_back(0);
-            // normals
-            vertices.push_back(0.0f);
-            vertices.push_back(0.0);
-            vertices.push_back(1.0f);
-            // texture coordinates
-            vertices.push_back(0.5f);
-            vertices.push_back(0.5f);
-
-            vertices.push_back(center.x + r * cos(theta1));
-            vertices.push_back(center.y + r * sin(theta1));
-            vertices.push_back(0);
-            // normals
-            vertices.push_back(0.0f);
-            vertices.push_back(0.0);
-            vertices.push_back(1.0f);
-            // texture coordinates
-            vertices.push_back(0.5f + 0.5f * cos(theta1));
-            vertices.push_back(0.5f + 0.5f * sin(theta1));
+        vertices.reserve((steps + 1) * 8);
+        addVertex(vertices, center.x, center.y, 0.5f, 0.5f);
 
-            vertices.push_back(center.x + r * cos(theta2));
-            vertices.push_back(center.y + r * sin(theta2));
-            vertices.push_back(0);
-            // normals
-            vertices.push_back(0.0f);
-            vertices.push_back(0.0);
-            vertices.push_back(1.0f);
-            // texture coordinates
-            vertices.push_back(0.5f + 0.5f * cos(theta2));
-            vertices.push_back(0.5f + 0.5f * sin(theta2));
+        for (int i = 0; i < steps; ++i) {
+            float theta = i * angleStep;
+            addVertex(vertices, 
+                center.x + r * cos(theta), center.y + r * sin(theta), 
+                0.5f + 0.5f * cos(theta), 0.5f + 0.5f * sin(theta));
         }
 
-        return vertices;
+        indices.reserve(steps * 3);
+        for (int i = 0; i < steps; ++i) {
+            indices.push_back(0);
+            indices.push_back(1 + i);
+            indices.push_back(1 + (i + 1) % steps);
+        }
     }
 
+private:
+    void addVertex(std::vector<float>& vertices, float x, float y, float u, float v) {
+        vertices.push_back(x);
+        vertices.push_back(y);
+        vertices.push_back(0);
+        // normals
+        vertices.push_back(0.0f);
+        vertices.push_back(0.0f);
+        vertices.push_back(1.0f);
+        // texture coordinates
+        vertices.push_back(u);
+        vertices.push_back(v);
+    }
 
 };
\ No newline at end of file
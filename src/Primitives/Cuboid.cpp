@@ -19,9 +19,10 @@ public:
 			return;
 		}
 
-        vertices = getVertices();
-        calculateBoundingBox(vertices, 8);
-        TransferDataToGPU(vertices, bb.vertices);
+        loadGeometry(GeometryKey(CUBOID, {center.x, center.y, center.z, size.x, size.y, size.z}), vertexFormat, 
+            [this](std::vector<float>& vertices, std::vector<unsigned int>& /*indices*/) {
+                vertices = getVertices();
+            });
     }
 
 private:
@@ -33,6 +34,7 @@ private:
 		return false;
     }
 
+public:
     std::vector<float> getVertices() {
         glm::vec3 vertices[] = {
             glm::vec3(center.x - size.x / 2, center.y - size.y / 2, center.z + size.z / 2), // 0: front-bottom-left
@@ -0,0 +1,200 @@
+#ifndef GEOMETRYCACHE_H
+#define GEOMETRYCACHE_H
+
+#include "Mesh.cpp"
+#include "../Spatial/OBB.cpp"
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <unordered_map>
+
+enum PrimitiveType {
+	TRIANGLE,
+	QUAD,
+	CIRCLE,
+	CUBOID,
+	SPHERE
+};
+
+// Identifies a generated shape by its type, the parameters its vertices
+// are built from (center, size, r, steps, ...) and its vertex format.
+struct GeometryKey {
+	static const int MAX_PARAMS = 8;
+
+	PrimitiveType type = TRIANGLE;
+	unsigned int format = 0;
+	int paramCount = 0;
+	float params[MAX_PARAMS] = {};
+
+	GeometryKey() {}
+
+	GeometryKey(PrimitiveType type, std::initializer_list<float> values) : type(type) {
+		for (float value : values) {
+			if (paramCount == MAX_PARAMS) {
+				std::cout << "ERROR: Too many parameters for GEOMETRY KEY" << std::endl;
+				break;
+			}
+			// adding 0 turns -0.0f into 0.0f so that equal keys hash equally
+			params[paramCount++] = value + 0.0f;
+		}
+	}
+
+	bool operator==(const GeometryKey& other) const {
+		if (type != other.type || format != other.format || paramCount != other.paramCount) {
+			return false;
+		}
+
+		for (int i = 0; i < paramCount; i++) {
+			if (params[i] != other.params[i]) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+struct GeometryKeyHash {
+	size_t operator()(const GeometryKey& key) const {
+		// FNV-1a over the type and the parameter bits
+		uint64_t hash = 14695981039346656037ull;
+		auto mix = [&hash](uint32_t value) {
+			for (int i = 0; i < 4; i++) {
+				hash ^= (value >> (i * 8)) & 0xff;
+				hash *= 1099511628211ull;
+			}
+		};
+
+		mix((uint32_t)key.type);
+		mix(key.format);
+		for (int i = 0; i < key.paramCount; i++) {
+			uint32_t bits;
+			std::memcpy(&bits, &key.params[i], sizeof(bits));
+			mix(bits);
+		}
+
+		return (size_t)hash;
+	}
+};
+
+struct GeometryCacheStats {
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int entries = 0;
+	size_t residentBytes = 0;
+	size_t cpuResidentBytes = 0;
+};
+
+// Owns one reference to a cache entry. Copies share it, and the reference is given
+// back when the last copy is destroyed.
+typedef std::shared_ptr<const GeometryKey> GeometryReference;
+
+// Shares one uploaded mesh between every primitive built with the same key.
+// Entries are reference counted and their GPU buffers are deleted once the
+// last reference to them is destroyed, which must happen while the GL context lives.
+class GeometryCache {
+
+public:
+	// On a hit fills mesh, bb and the CPU geometry, if the entry has one, and takes a reference.
+	static bool acquire(const GeometryKey& key, Mesh& mesh, OBB& bb, std::shared_ptr<const MeshGeometry>& geometry, GeometryReference& reference) {
+		auto it = entries().find(key);
+		if (it == entries().end()) {
+			statistics().misses++;
+			return false;
+		}
+
+		statistics().hits++;
+		it->second.refCount++;
+		mesh = it->second.mesh;
+		bb = it->second.bb;
+		geometry = it->second.geometry;
+		reference = makeReference(key);
+		return true;
+	}
+
+	// Registers a freshly uploaded mesh and returns the reference of its creator.
+	static GeometryReference insert(const GeometryKey& key, const Mesh& mesh, const OBB& bb, std::shared_ptr<const MeshGeometry> geometry) {
+		Entry entry;
+		entry.mesh = mesh;
+		entry.bb = bb;
+
+		auto inserted = entries().emplace(key, entry);
+		if (inserted.second) {
+			statistics().entries++;
+			statistics().residentBytes += mesh.gpuMemoryUsage();
+			attachGeometry(key, geometry);
+		}
+		inserted.first->second.refCount++;
+		return makeReference(key);
+	}
+
+	// Gives an entry that was uploaded without one a CPU copy of its geometry.
+	static void attachGeometry(const GeometryKey& key, std::shared_ptr<const MeshGeometry> geometry) {
+		auto it = entries().find(key);
+		if (it == entries().end() || it->second.geometry != nullptr || geometry == nullptr) {
+			return;
+		}
+
+		it->second.geometry = geometry;
+		statistics().cpuResidentBytes += geometry->memoryUsage();
+	}
+
+	static const GeometryCacheStats& stats() {
+		return statistics();
+	}
+
+	static void printStats() {
+		const GeometryCacheStats& s = statistics();
+		std::cout << "Geometry cache: " << s.hits << " hits, " << s.misses << " misses, "
+			<< s.entries << " meshes, " << s.residentBytes << " bytes resident, "
+			<< s.cpuResidentBytes << " bytes of CPU geometry" << std::endl;
+	}
+
+private:
+	struct Entry {
+		Mesh mesh;
+		OBB bb;
+		std::shared_ptr<const MeshGeometry> geometry;
+		int refCount = 0;
+	};
+
+	static GeometryReference makeReference(const GeometryKey& key) {
+		return GeometryReference(new GeometryKey(key), [](const GeometryKey* owned) {
+			release(*owned);
+			delete owned;
+		});
+	}
+
+	static void release(const GeometryKey& key) {
+		auto it = entries().find(key);
+		if (it == entries().end()) {
+			return;
+		}
+
+		if (--it->second.refCount > 0) {
+			return;
+		}
+
+		statistics().entries--;
+		statistics().residentBytes -= it->second.mesh.gpuMemoryUsage();
+		if (it->second.geometry != nullptr) {
+			statistics().cpuResidentBytes -= it->second.geometry->memoryUsage();
+		}
+		it->second.mesh.release();
+		entries().erase(it);
+	}
+
+	static std::unordered_map<GeometryKey, Entry, GeometryKeyHash>& entries() {
+		static std::unordered_map<GeometryKey, Entry, GeometryKeyHash> map;
+		return map;
+	}
+
+	static GeometryCacheStats& statistics() {
+		static GeometryCacheStats s;
+		return s;
+	}
+};
+
+#endif
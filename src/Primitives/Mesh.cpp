@@ -0,0 +1,147 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "VertexFormat.cpp"
+#include "../Rendering/GLState.cpp"
+
+#include "../../dependencies/glad.h"
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// CPU copy of a mesh, only kept for primitives that ask for it (collision, picking)
+struct MeshGeometry {
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+
+	size_t memoryUsage() const {
+		return vertices.capacity() * sizeof(float) + indices.capacity() * sizeof(unsigned int);
+	}
+};
+
+// GPU side of a primitive's geometry. Meshes are plain handles, so several
+// primitives can share one through the GeometryCache.
+struct Mesh {
+	unsigned int VAO = 0, VBO = 0, EBO = 0;
+	unsigned int bbVAO = 0, bbVBO = 0;
+
+	unsigned int vertexCount = 0;
+	unsigned int indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	size_t vertexBufferSize = 0;
+	size_t indexBufferSize = 0;
+
+	VertexFormat format;
+	// Normal of every vertex when the format stores none, flat primitives face +z
+	glm::vec3 constantNormal = glm::vec3(0.0f, 0.0f, 1.0f);
+
+	// Packs the interleaved 8 float vertices into the given format and uploads them and, when given, an element buffer. Indices are
+	// stored as 16-bit whenever every vertex can be addressed with them. bbVertices are the 8 corners of the debug lines.
+	void upload(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, const std::vector<float>& bbVertices, VertexFormat vertexFormat) {
+		format = vertexFormat;
+		vertexCount = vertices.size() / 8;
+		indexCount = indices.size();
+
+		std::vector<unsigned char> packed = format.pack(vertices);
+		vertexBufferSize = packed.size();
+
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertexBufferSize, packed.data(), GL_STATIC_DRAW);
+
+		GLState::bindVertexArray(VAO);
+
+		if (indexCount > 0) {
+			glGenBuffers(1, &EBO);
+			// the element buffer binding is part of the VAO state
+			GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+			if (vertexCount <= 65536) {
+				std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+				indexType = GL_UNSIGNED_SHORT;
+				indexBufferSize = shortIndices.size() * sizeof(unsigned short);
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferSize, shortIndices.data(), GL_STATIC_DRAW);
+			} else {
+				indexType = GL_UNSIGNED_INT;
+				indexBufferSize = indices.size() * sizeof(unsigned int);
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferSize, indices.data(), GL_STATIC_DRAW);
+			}
+		}
+
+		format.setAttributes();
+
+		GLState::bindVertexArray(0);
+
+		glGenVertexArrays(1, &bbVAO);
+		glGenBuffers(1, &bbVBO);
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, bbVBO);
+		glBufferData(GL_ARRAY_BUFFER, bbVertices.size() * sizeof(float), bbVertices.data(), GL_STATIC_DRAW);
+
+		GLState::bindVertexArray(bbVAO);
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+
+		GLState::bindVertexArray(0);
+	}
+
+	// Stays bound after drawing, GLState drops the bind when the next draw uses the same mesh
+	void bind() const {
+		GLState::bindVertexArray(VAO);
+
+		// attributes without an array read the current generic value, which is
+		// context state and not part of the VAO, so it is set for every bind
+		if (format.normal == NORMAL_NONE) {
+			glVertexAttrib3f(1, constantNormal.x, constantNormal.y, constantNormal.z);
+		}
+		if (format.normal != NORMAL_OCTAHEDRAL) {
+			glVertexAttrib4f(OCTAHEDRAL_NORMAL_LOCATION, 0.0f, 0.0f, 0.0f, 0.0f);
+		}
+	}
+
+	void draw() const {
+		bind();
+		if (indexCount > 0) {
+			glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+		} else {
+			glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+		}
+	}
+
+	// Expects bind() to have been called and the per-instance attributes to be set up.
+	void drawInstanced(unsigned int instanceCount) const {
+		if (indexCount > 0) {
+			glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, instanceCount);
+		} else {
+			glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, instanceCount);
+		}
+	}
+
+	void release() {
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		glDeleteVertexArrays(1, &bbVAO);
+		glDeleteBuffers(1, &bbVBO);
+		VAO = VBO = EBO = bbVAO = bbVBO = 0;
+		// deleted names that were bound are unbound by GL and may be handed out again
+		GLState::invalidate();
+	}
+
+	size_t gpuMemoryUsage() const {
+		return vertexBufferSize + indexBufferSize;
+	}
+
+	void printMemoryUsage(const std::string& name) const {
+		std::cout << name << ": " << vertexCount << " vertices (" << vertexBufferSize << " bytes), "
+			<< indexCount << " indices (" << indexBufferSize << " bytes), "
+			<< gpuMemoryUsage() << " bytes total" << std::endl;
+	}
+};
+
+#endif
@@ -2,7 +2,10 @@
 #define PRIMITIVE_H
 
 #include "../Shader.cpp"
-#include "../BoundingBox.cpp"
+#include "../ShaderVariants.cpp"
+#include "../Spatial/OBB.cpp"
+#include "Mesh.cpp"
+#include "GeometryCache.cpp"
 
 #include "../../dependencies/stb_image.h"
 
@@ -15,21 +18,45 @@
 class Primitive {
 
 public:
-	unsigned int VBO, VAO, bbVBO, bbVAO;
+	Mesh mesh;
+	GeometryKey geometryKey;
+	// Keeps mesh in the GeometryCache while this primitive or a copy of it lives, null when headless
+	GeometryReference geometryReference;
 
     Shader shader;
 	Shader normalsShader;
 
-	std::vector<float> vertices;
+	// CPU copy of the vertices and indices, null unless keepCPUGeometry was set when the
+	// primitive was built. Otherwise only the counts in mesh and the bounds in localBB remain.
+	std::shared_ptr<const MeshGeometry> geometry;
 
-	BoundingBox bb;
+	// Opt-in for primitives built from now on, e.g. for collision against their triangles
+	inline static bool keepCPUGeometry = false;
 
+	// Primitives built from now on only generate their vertices and bounds and upload nothing,
+	// for tools and benchmarks that run without a GL context
+	inline static bool headless = false;
+
+	// GPU vertex layout of primitives built from now on. Flat primitives use it
+	// without the normals, VertexFormat::standard() is the uncompressed layout.
+	inline static VertexFormat vertexFormat;
+
+	// Collision box in model space, and the same box in world space kept current by the scene
+	OBB localBB = OBB::fromMinMax(glm::vec3(0.0f), glm::vec3(0.0f));
+	OBB bb = localBB;
+
+	// Initial transform, copied into the scene's TransformStore entry transformId
 	glm::vec3 translation;
 	glm::vec3 scale;
 	glm::vec3 rotation;
+	unsigned int transformId = 0;
+	// Objects that move after loading. The others are baked into the static hierarchies.
+	bool dynamic = false;
 
 	glm::vec3 color;
 	bool useSolidColor;
+	// Whether the directional light's shadow map darkens this object
+	bool receiveShadows = true;
 
     const unsigned int* diffuseMap;
     const unsigned int* specularMap;
@@ -46,10 +73,42 @@ public:
 
     }
 
+	// The defines of the permutation of the lighting program this object needs, sceneDefines
+	// holds what all objects share, e.g. the number of point lights
+	ShaderDefines variantDefines(ShaderDefines sceneDefines) const {
+		sceneDefines.set("SOLID_COLOR", useSolidColor);
+		if (!receiveShadows) {
+			sceneDefines.set("SHADOWS", 0);
+		}
+		return sceneDefines;
+	}
+
+	// Makes shader that permutation
+	void selectShaderVariant(ShaderVariants& variants, const ShaderDefines& sceneDefines) {
+		shader = variants.get(variantDefines(sceneDefines));
+	}
+
 	void draw() {
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 8);
-		glBindVertexArray(0);
+		mesh.draw();
+	}
+
+	size_t gpuMemoryUsage() const {
+		return mesh.gpuMemoryUsage();
+	}
+
+	// Bytes this object keeps in CPU memory, without the shared CPU geometry
+	size_t cpuMemoryUsage() const {
+		return sizeof(Primitive);
+	}
+
+	size_t sharedGeometryUsage() const {
+		return geometry != nullptr ? geometry->memoryUsage() : 0;
+	}
+
+	void printMemoryUsage(const std::string& name) const {
+		mesh.printMemoryUsage(name);
+		std::cout << name << ": " << cpuMemoryUsage() << " bytes CPU resident, "
+			<< sharedGeometryUsage() << " bytes shared CPU geometry" << std::endl;
 	}
 
 	void drawBB() {
@@ -59,23 +118,22 @@ public:
 			0,4, 1,5, 2,6, 3,7  // connecting edges
 		};
 
+		// the element buffer binding is part of the vertex array, so it is bound to this one
+		// before the buffer is created instead of to whichever was left bound
+		GLState::bindVertexArray(mesh.bbVAO);
+
 		static unsigned int bbEBO = 0;
 		if (bbEBO == 0) {
 			glGenBuffers(1, &bbEBO);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bbEBO);
+			GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, bbEBO);
 			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, bbVBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, bb.vertices.size() * sizeof(float), bb.vertices.data());
-
-		glBindVertexArray(bbVAO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bbEBO);
+		GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, bbEBO);
 		glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
 	}
 
-	void calculateBoundingBox(std::vector<float> vertices, int vertexSize) {
+	void calculateBoundingBox(const std::vector<float>& vertices, int vertexSize) {
 		float minX = INFINITY, minY = INFINITY, minZ = INFINITY;
 		float maxX = -INFINITY, maxY = -INFINITY, maxZ = -INFINITY;
 
@@ -123,53 +181,51 @@ public:
 		glm::vec3 minVert = glm::vec3(minX, minY, minZ);
 		glm::vec3 maxVert = glm::vec3(maxX, maxY, maxZ);
 
-		std::vector<float> bbVertices = {
-			minX, minY, maxZ, // 0: front-bottom-left
-			maxX, minY, maxZ, // 1: front-bottom-right
-			maxX, maxY, maxZ, // 2: front-top-right
-			minX, maxY, maxZ, // 3: front-top-left
-			minX, minY, minZ, // 4: back-bottom-left
-			maxX, minY, minZ, // 5: back-bottom-right
-			maxX, maxY, minZ, // 6: back-top-right
-			minX, maxY, minZ  // 7: back-top-left
-		};
-		
-		bb = BoundingBox(bbVertices, minVert, maxVert);
+		localBB = OBB::fromMinMax(minVert, maxVert);
+		bb = localBB;
 	}
 
 protected:
-	void TransferDataToGPU(std::vector<float> vertices, std::vector<float> bbVertices) {
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-		glBindVertexArray(VAO);
-
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(1);
-
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-
-		glBindVertexArray(0);
+	// Takes the mesh and bounding box of an identical shape from the geometry cache, and
+	// only generates and uploads the vertices when no such shape has been built yet.
+	// The generated vertices are dropped after the upload unless keepCPUGeometry is set.
+	template <typename Generate>
+	void loadGeometry(GeometryKey key, VertexFormat format, Generate generate) {
+		key.format = format.code();
+		geometryKey = key;
+
+		if (headless) {
+			MeshGeometry generated;
+			generate(generated.vertices, generated.indices);
+			calculateBoundingBox(generated.vertices, 8);
+			if (keepCPUGeometry) {
+				geometry = std::make_shared<const MeshGeometry>(std::move(generated));
+			}
+			return;
+		}
 
-		glGenVertexArrays(1, &bbVAO);
-		glGenBuffers(1, &bbVBO);
+		bool cached = GeometryCache::acquire(key, mesh, localBB, geometry, geometryReference);
+		if (cached && (geometry != nullptr || !keepCPUGeometry)) {
+			return;
+		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, bbVBO);
-		glBufferData(GL_ARRAY_BUFFER, bbVertices.size() * sizeof(float), bbVertices.data(), GL_STATIC_DRAW);
+		MeshGeometry generated;
+		generate(generated.vertices, generated.indices);
 
-		glBindVertexArray(bbVAO);
+		if (!cached) {
+			calculateBoundingBox(generated.vertices, 8);
+			mesh.upload(generated.vertices, generated.indices, localBB.cornerVertices(), format);
+		}
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
+		if (keepCPUGeometry) {
+			geometry = std::make_shared<const MeshGeometry>(std::move(generated));
+		}
 
-		glBindVertexArray(0);
+		if (cached) {
+			GeometryCache::attachGeometry(key, geometry);
+		} else {
+			geometryReference = GeometryCache::insert(key, mesh, localBB, geometry);
+		}
 	}
 
 };
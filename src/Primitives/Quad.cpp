@@ -19,9 +19,10 @@ public:
 			return;
 		}
 
-		vertices = getVertices();
-		calculateBoundingBox(vertices, 8);
-		TransferDataToGPU(vertices, bb.vertices);	
+		loadGeometry(GeometryKey(QUAD, {center.x, center.y, size.x, size.y}), vertexFormat.withoutNormals(), 
+			[this](std::vector<float>& vertices, std::vector<unsigned int>& /*indices*/) {
+				vertices = getVertices();
+			});
 	}
 
 private:
@@ -33,6 +34,7 @@ private:
 		return false;
 	}
 
+public:
 	std::vector<float> getVertices() {
 		glm::vec3 v1(center.x - size.x / 2, center.y + size.y / 2, 0.0);
 		glm::vec3 v2(center.x - size.x / 2, center.y - size.y / 2, 0.0);
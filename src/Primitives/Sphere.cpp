@@ -22,61 +22,55 @@ public:
             return;
         }
 
-        vertices = getVertices();
-        calculateBoundingBox(vertices, 8);
-        TransferDataToGPU(vertices, bb.vertices);	
+        loadGeometry(GeometryKey(SPHERE, {center.x, center.y, center.z, r, (float)steps}), vertexFormat, 
+            [this](std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+                getVertices(vertices, indices);
+            });
     }
 
-private:
-    std::vector<float> getVertices() {
-        std::vector<float> vertices;
-
+public:
+    // Builds a (steps + 1) x (steps + 1) grid of shared vertices over theta and phi.
+    // The seam and pole rows are duplicated so that every vertex keeps its own uv.
+    void getVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices) {
         float phiStep = 2.0f * M_PI / steps;
         float thetaStep = M_PI / steps;
 
-        // Generate vertices and triangles for the sphere
-        for (int i = 0; i < steps; ++i) {
-            float theta1 = i * thetaStep;
-            float theta2 = (i + 1) * thetaStep;
+        vertices.reserve((steps + 1) * (steps + 1) * 8);
+        for (int i = 0; i <= steps; ++i) {
+            float theta = i * thetaStep;
+
+            for (int j = 0; j <= steps; ++j) {
+                float phi = j * phiStep;
+                addVertex(vertices, sphericalToCartesian(theta, phi), theta, phi);
+            }
+        }
 
+        auto index = [this](int i, int j) {
+            return (unsigned int)(i * (steps + 1) + j);
+        };
+
+        // Generate triangles for the sphere
+        indices.reserve((steps - 1) * steps * 6);
+        for (int i = 0; i < steps; ++i) {
             for (int j = 0; j < steps; ++j) {
-                float phi1 = j * phiStep;
-                float phi2 = (j + 1) * phiStep;
-
-                // Calculate the 4 vertices of the current patch
-                glm::vec3 v1 = sphericalToCartesian(theta1, phi1);
-                glm::vec3 v2 = sphericalToCartesian(theta1, phi2);
-                glm::vec3 v3 = sphericalToCartesian(theta2, phi2);
-                glm::vec3 v4 = sphericalToCartesian(theta2, phi1);
-
-                if (i == 0) {
-                    // North pole needs only one triangle
-                    addVertex(vertices, v4, theta1, phi1);
-                    addVertex(vertices, v3, theta2, phi2);
-                    addVertex(vertices, v1, theta2, phi1);
-                }
-                else if (i == steps - 1) {
-                    // South pole needs only one triangle
-                    addVertex(vertices, v3, theta1, phi1);
-                    addVertex(vertices, v2, theta1, phi2);
-                    addVertex(vertices, v1, theta2, phi2);
+                if (i != steps - 1) {
+                    // Every row but the south pole needs this triangle
+                    indices.push_back(index(i + 1, j + 1));
+                    indices.push_back(index(i, j));
+                    indices.push_back(index(i + 1, j));
                 }
-                else {
-                    // Middle needs two triangles
-                    addVertex(vertices, v3, theta1, phi1);
-                    addVertex(vertices, v2, theta1, phi2);
-                    addVertex(vertices, v1, theta2, phi2);
-
-                    addVertex(vertices, v3, theta1, phi1);
-                    addVertex(vertices, v1, theta2, phi2);
-                    addVertex(vertices, v4, theta2, phi1);
+
+                if (i != 0) {
+                    // Every row but the north pole needs this triangle
+                    indices.push_back(index(i + 1, j + 1));
+                    indices.push_back(index(i, j + 1));
+                    indices.push_back(index(i, j));
                 }
             }
         }
-
-        return vertices;
     }
 
+private:
     glm::vec3 sphericalToCartesian(float theta, float phi) {
         float x = r * sin(theta) * cos(phi) + center.x;
         float y = r * sin(theta) * sin(phi) + center.y;
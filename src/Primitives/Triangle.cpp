@@ -20,9 +20,10 @@ public:
 			return;
 		}
 
-		vertices = getVertices();
-		calculateBoundingBox(vertices, 8);
-        TransferDataToGPU(vertices, bb.vertices);
+		loadGeometry(GeometryKey(TRIANGLE, {v1.x, v1.y, v2.x, v2.y, v3.x, v3.y}), vertexFormat.withoutNormals(), 
+			[this](std::vector<float>& vertices, std::vector<unsigned int>& /*indices*/) {
+				vertices = getVertices();
+			});
 	}
 
 private:
@@ -34,6 +35,7 @@ private:
 		return false;
 	}
 
+public:
 	std::vector<float> getVertices() {
 		std::vector<float> vertices = {
 		  //Vertex Positions   -    Normals       -  Texture coords
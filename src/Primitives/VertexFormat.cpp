@@ -0,0 +1,230 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include "../../dependencies/glad.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Attribute location of octahedral normals, the shader uses it instead of location 1
+// whenever its w component is 1, which only an enabled 2 component array provides.
+const unsigned int OCTAHEDRAL_NORMAL_LOCATION = 11;
+
+enum PositionFormat {
+	POSITION_FLOAT,  // 12 bytes
+	POSITION_HALF    // 8 bytes, 3 halfs padded to keep the next attribute aligned
+};
+
+enum NormalFormat {
+	NORMAL_FLOAT,          // 12 bytes
+	NORMAL_INT_2_10_10_10, // 4 bytes, GL_INT_2_10_10_10_REV normalized
+	NORMAL_OCTAHEDRAL,     // 4 bytes, two normalized shorts
+	NORMAL_NONE            // 0 bytes, the mesh's constant normal is used
+};
+
+enum UVFormat {
+	UV_FLOAT,   // 8 bytes
+	UV_HALF,    // 4 bytes
+	UV_UNORM16  // 4 bytes, only for coordinates in [0, 1]
+};
+
+// Describes how the interleaved position / normal / uv vertices of a mesh are stored
+// on the GPU. Generators always produce 8 floats per vertex, pack() converts them to
+// this format and setAttributes() describes the result to GL.
+// The default is 16 bytes for closed shapes and 12 for flat ones without normals.
+struct VertexFormat {
+	PositionFormat position = POSITION_HALF;
+	NormalFormat normal = NORMAL_OCTAHEDRAL;
+	UVFormat uv = UV_HALF;
+
+	VertexFormat() {}
+
+	VertexFormat(PositionFormat position, NormalFormat normal, UVFormat uv)
+		: position(position), normal(normal), uv(uv) {}
+
+	// The uncompressed 32 byte layout every primitive used to have
+	static VertexFormat standard() {
+		return VertexFormat(POSITION_FLOAT, NORMAL_FLOAT, UV_FLOAT);
+	}
+
+	// For flat shapes, whose normal is the same for every vertex
+	VertexFormat withoutNormals() const {
+		return VertexFormat(position, NORMAL_NONE, uv);
+	}
+
+	// Distinguishes formats in geometry cache keys
+	unsigned int code() const {
+		return position | (normal << 4) | (uv << 8);
+	}
+
+	unsigned int positionSize() const {
+		return position == POSITION_FLOAT ? 12 : 8;
+	}
+
+	unsigned int normalSize() const {
+		switch (normal) {
+			case NORMAL_FLOAT: return 12;
+			case NORMAL_NONE: return 0;
+			default: return 4;
+		}
+	}
+
+	unsigned int uvSize() const {
+		return uv == UV_FLOAT ? 8 : 4;
+	}
+
+	unsigned int stride() const {
+		return positionSize() + normalSize() + uvSize();
+	}
+
+	std::vector<unsigned char> pack(const std::vector<float>& vertices) const {
+		size_t count = vertices.size() / 8;
+		std::vector<unsigned char> packed(count * stride(), 0);
+
+		for (size_t i = 0; i < count; i++) {
+			const float* v = &vertices[i * 8];
+			unsigned char* out = &packed[i * stride()];
+
+			if (position == POSITION_FLOAT) {
+				std::memcpy(out, v, 12);
+			} else {
+				uint16_t halfs[3] = { toHalf(v[0]), toHalf(v[1]), toHalf(v[2]) };
+				std::memcpy(out, halfs, sizeof(halfs));
+			}
+			out += positionSize();
+
+			if (normal == NORMAL_FLOAT) {
+				std::memcpy(out, v + 3, 12);
+			} else if (normal == NORMAL_INT_2_10_10_10) {
+				uint32_t word = toSnorm10(v[3]) | (toSnorm10(v[4]) << 10) | (toSnorm10(v[5]) << 20);
+				std::memcpy(out, &word, sizeof(word));
+			} else if (normal == NORMAL_OCTAHEDRAL) {
+				int16_t encoded[2];
+				encodeOctahedral(v[3], v[4], v[5], encoded);
+				std::memcpy(out, encoded, sizeof(encoded));
+			}
+			out += normalSize();
+
+			if (uv == UV_FLOAT) {
+				std::memcpy(out, v + 6, 8);
+			} else if (uv == UV_HALF) {
+				uint16_t halfs[2] = { toHalf(v[6]), toHalf(v[7]) };
+				std::memcpy(out, halfs, sizeof(halfs));
+			} else {
+				uint16_t unorms[2] = { toUnorm16(v[6]), toUnorm16(v[7]) };
+				std::memcpy(out, unorms, sizeof(unorms));
+			}
+		}
+
+		return packed;
+	}
+
+	// Sets up locations 0 (position), 1 (normal), 2 (uv) and OCTAHEDRAL_NORMAL_LOCATION
+	// of the bound VAO for the bound GL_ARRAY_BUFFER.
+	void setAttributes() const {
+		GLsizei size = stride();
+		size_t offset = 0;
+
+		if (position == POSITION_FLOAT) {
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, size, (void*)offset);
+		} else {
+			glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, size, (void*)offset);
+		}
+		glEnableVertexAttribArray(0);
+		offset += positionSize();
+
+		if (normal == NORMAL_FLOAT) {
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, size, (void*)offset);
+			glEnableVertexAttribArray(1);
+		} else if (normal == NORMAL_INT_2_10_10_10) {
+			glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, size, (void*)offset);
+			glEnableVertexAttribArray(1);
+		} else if (normal == NORMAL_OCTAHEDRAL) {
+			glVertexAttribPointer(OCTAHEDRAL_NORMAL_LOCATION, 2, GL_SHORT, GL_TRUE, size, (void*)offset);
+			glEnableVertexAttribArray(OCTAHEDRAL_NORMAL_LOCATION);
+		}
+		offset += normalSize();
+
+		if (uv == UV_FLOAT) {
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, size, (void*)offset);
+		} else if (uv == UV_HALF) {
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, size, (void*)offset);
+		} else {
+			glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, size, (void*)offset);
+		}
+		glEnableVertexAttribArray(2);
+	}
+
+	static uint16_t toHalf(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		if (((bits >> 23) & 0xff) == 0xff) {
+			// infinity or NaN
+			return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+		}
+		if (exponent >= 31) {
+			return sign | 0x7c00;
+		}
+		if (exponent <= 0) {
+			// subnormal half, or zero when too small
+			if (exponent < -10) {
+				return sign;
+			}
+			mantissa |= 0x800000;
+			int shift = 14 - exponent;
+			uint32_t half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1) {
+				half++;
+			}
+			return sign | half;
+		}
+
+		// rounding may carry into the exponent, which is still the correct result
+		uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000) {
+			half++;
+		}
+		return half;
+	}
+
+private:
+	static uint32_t toSnorm10(float value) {
+		float clamped = std::fmax(-1.0f, std::fmin(1.0f, value));
+		return (uint32_t)(int32_t)std::lround(clamped * 511.0f) & 0x3ff;
+	}
+
+	static uint16_t toUnorm16(float value) {
+		float clamped = std::fmax(0.0f, std::fmin(1.0f, value));
+		return (uint16_t)std::lround(clamped * 65535.0f);
+	}
+
+	// Projects the normal onto an octahedron and unfolds it into the [-1, 1] square
+	static void encodeOctahedral(float x, float y, float z, int16_t encoded[2]) {
+		float sum = std::fabs(x) + std::fabs(y) + std::fabs(z);
+		if (sum == 0.0f) {
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+
+		float u = x / sum;
+		float v = y / sum;
+		if (z < 0.0f) {
+			float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+			u = foldedU;
+			v = foldedV;
+		}
+
+		encoded[0] = (int16_t)std::lround(std::fmax(-1.0f, std::fmin(1.0f, u)) * 32767.0f);
+		encoded[1] = (int16_t)std::lround(std::fmax(-1.0f, std::fmin(1.0f, v)) * 32767.0f);
+	}
+};
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef PROGRAMBINARYCACHE_H
+#define PROGRAMBINARYCACHE_H
+
+#include "../dependencies/glad.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// A stored program binary and the driver format it is in
+struct ProgramBinary {
+	GLenum format = 0;
+	std::vector<char> data;
+};
+
+struct ProgramBinaryCacheStats {
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int rejected = 0; // stored binaries the driver refused, e.g. after a driver update
+	unsigned int stored = 0;
+};
+
+// Linked programs saved with glGetProgramBinary and loaded back with glProgramBinary on the
+// next start, so warm starts skip compiling and linking. A binary is only valid for the
+// driver that produced it, which is part of the key next to the sources. Needs GL 4.1 or
+// ARB_get_program_binary, without it every program is compiled as before.
+class ProgramBinaryCache {
+
+public:
+	inline static bool enabled = true;
+	inline static std::string directory = "shader_cache";
+
+	// Key of a program built from the given sources, defines included, on the current driver
+	static uint64_t key(const std::vector<std::string>& sources) {
+		uint64_t hash = 14695981039346656037ull;
+		auto mix = [&hash](const std::string& text) {
+			for (unsigned char c : text) {
+				hash ^= c;
+				hash *= 1099511628211ull;
+			}
+			// separates the strings, so moving text from one to the next changes the key
+			hash ^= 0xff;
+			hash *= 1099511628211ull;
+		};
+
+		mix(glString(GL_VENDOR));
+		mix(glString(GL_RENDERER));
+		mix(glString(GL_VERSION));
+		for (const std::string& source : sources) {
+			mix(source);
+		}
+		return hash;
+	}
+
+	// Reads the binary stored under key. False when there is none or the driver cannot load
+	// binaries, the program then has to be linked from source. Needs no program object.
+	static bool read(uint64_t key, ProgramBinary& binary) {
+		if (!available()) {
+			return false;
+		}
+
+		std::ifstream file(path(key), std::ios::binary);
+		Header header;
+		if (!file || !file.read((char*)&header, sizeof(header)) || header.magic != MAGIC) {
+			statistics().misses++;
+			return false;
+		}
+
+		binary.format = header.format;
+		binary.data.resize(header.length);
+		if (!file.read(binary.data.data(), binary.data.size())) {
+			statistics().misses++;
+			return false;
+		}
+		return true;
+	}
+
+	// Loads a binary read under key into program. False when the driver rejects it, which
+	// leaves program unlinked and ready to be linked from source.
+	static bool load(uint64_t key, const ProgramBinary& binary, GLuint program) {
+		glProgramBinary(program, binary.format, binary.data.data(), (GLsizei)binary.data.size());
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			statistics().rejected++;
+			std::remove(path(key).c_str());
+			return false;
+		}
+
+		statistics().hits++;
+		return true;
+	}
+
+	// Must be called before linking a program that is going to be stored
+	static void prepare(GLuint program) {
+		if (available()) {
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+	}
+
+	// Saves a successfully linked program under key
+	static void store(uint64_t key, GLuint program) {
+		if (!available()) {
+			return;
+		}
+
+		GLint linked = GL_FALSE, length = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (!linked || length <= 0) {
+			return;
+		}
+
+		Header header;
+		std::vector<char> binary(length);
+		GLsizei written = 0;
+		glGetProgramBinary(program, length, &written, &header.format, binary.data());
+		header.length = written;
+
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		std::ofstream file(path(key), std::ios::binary);
+		if (!file) {
+			std::cout << "WARNING::PROGRAM_BINARY_CACHE::CANNOT_WRITE: " << path(key) << std::endl;
+			return;
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write(binary.data(), written);
+		statistics().stored++;
+	}
+
+	static const ProgramBinaryCacheStats& stats() {
+		return statistics();
+	}
+
+	static void printStats() {
+		const ProgramBinaryCacheStats& s = statistics();
+		if (!available()) {
+			std::cout << "Program binary cache: not supported by the driver" << std::endl;
+			return;
+		}
+		std::cout << "Program binary cache: " << s.hits << " hits, " << s.misses << " misses, "
+			<< s.rejected << " rejected, " << s.stored << " stored" << std::endl;
+	}
+
+private:
+	static const uint32_t MAGIC = 0x42504c47; // "GLPB"
+
+	struct Header {
+		uint32_t magic = MAGIC;
+		GLenum format = 0;
+		uint32_t length = 0;
+	};
+
+	static bool available() {
+		// -1 until the driver has been asked
+		static int supported = -1;
+		if (supported < 0) {
+			GLint formats = 0;
+			if (GLAD_GL_VERSION_4_1 && glGetProgramBinary != nullptr) {
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			}
+			supported = formats > 0;
+		}
+		return enabled && supported;
+	}
+
+	static std::string glString(GLenum name) {
+		const GLubyte* text = glGetString(name);
+		return text != nullptr ? (const char*)text : "";
+	}
+
+	static std::string path(uint64_t key) {
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return directory + "/" + name;
+	}
+
+	static ProgramBinaryCacheStats& statistics() {
+		static ProgramBinaryCacheStats s;
+		return s;
+	}
+};
+
+#endif
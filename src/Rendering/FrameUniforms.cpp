@@ -0,0 +1,129 @@
+#ifndef FRAMEUNIFORMS_H
+#define FRAMEUNIFORMS_H
+
+#include "../Shader.cpp"
+#include "GLState.cpp"
+#include "../Lights/DirectionalLight.cpp"
+#include "../Lights/PointLight.cpp"
+
+#include "../../dependencies/glad.h"
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <vector>
+
+// Size of the pointLights array in the Lights block. NR_POINT_LIGHTS in the
+// shaders must not be larger, the array is the last member so shaders may read fewer.
+const unsigned int MAX_POINT_LIGHTS = 8;
+
+// C++ mirrors of the std140 blocks declared in the shaders. vec3 members are
+// followed by a float or padded to 16 bytes, as std140 aligns them like vec4.
+struct CameraBlock {
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::mat4 lightSpaceMatrix;
+	glm::vec4 viewPos;
+};
+
+struct DirLightStd140 {
+	glm::vec4 direction;
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+};
+
+struct PointLightStd140 {
+	glm::vec3 position;
+	float constant;
+	glm::vec3 ambient;
+	float linear;
+	glm::vec3 diffuse;
+	float quadratic;
+	glm::vec3 specular;
+	float padding;
+};
+
+struct LightsBlock {
+	DirLightStd140 dirLight;
+	PointLightStd140 pointLights[MAX_POINT_LIGHTS];
+};
+
+static_assert(sizeof(CameraBlock) == 208, "CameraBlock does not match the std140 layout");
+static_assert(sizeof(PointLightStd140) == 64, "PointLightStd140 does not match the std140 layout");
+static_assert(sizeof(LightsBlock) == 64 + 64 * MAX_POINT_LIGHTS, "LightsBlock does not match the std140 layout");
+
+// Camera and light data that is the same for every object of a frame. Both blocks
+// live in one buffer and are written with a single call per frame.
+class FrameUniforms {
+
+public:
+	void update(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos, const glm::mat4& lightSpaceMatrix,
+		const DirectionalLight& dirLight, const std::vector<PointLight>& pointLights) {
+		if (UBO == 0) {
+			create();
+		}
+
+		CameraBlock camera;
+		camera.projection = projection;
+		camera.view = view;
+		camera.lightSpaceMatrix = lightSpaceMatrix;
+		camera.viewPos = glm::vec4(viewPos, 1.0f);
+
+		LightsBlock lights = {};
+		lights.dirLight.direction = glm::vec4(dirLight.direction, 0.0f);
+		lights.dirLight.ambient = glm::vec4(dirLight.ambient, 0.0f);
+		lights.dirLight.diffuse = glm::vec4(dirLight.diffuse, 0.0f);
+		lights.dirLight.specular = glm::vec4(dirLight.specular, 0.0f);
+
+		if (pointLights.size() > MAX_POINT_LIGHTS && !reportedLightCount) {
+			std::cout << "WARNING: Only the first " << MAX_POINT_LIGHTS << " point lights are uploaded" << std::endl;
+			reportedLightCount = true;
+		}
+
+		for (size_t i = 0; i < pointLights.size() && i < MAX_POINT_LIGHTS; i++) {
+			PointLightStd140& light = lights.pointLights[i];
+			light.position = pointLights[i].position;
+			light.constant = pointLights[i].constant;
+			light.ambient = pointLights[i].ambient;
+			light.linear = pointLights[i].linear;
+			light.diffuse = pointLights[i].diffuse;
+			light.quadratic = pointLights[i].quadratic;
+			light.specular = pointLights[i].specular;
+		}
+
+		std::memcpy(staging.data(), &camera, sizeof(CameraBlock));
+		std::memcpy(staging.data() + lightsOffset, &lights, sizeof(LightsBlock));
+
+		GLState::bindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, staging.size(), staging.data());
+	}
+
+	void release() {
+		glDeleteBuffers(1, &UBO);
+		UBO = 0;
+		GLState::invalidate();
+	}
+
+private:
+	unsigned int UBO = 0;
+	size_t lightsOffset = 0;
+	std::vector<unsigned char> staging;
+	bool reportedLightCount = false;
+
+	void create() {
+		// the lights block starts at the next offset the driver allows a range to be bound at
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		lightsOffset = (sizeof(CameraBlock) + alignment - 1) / alignment * alignment;
+		staging.assign(lightsOffset + sizeof(LightsBlock), 0);
+
+		glGenBuffers(1, &UBO);
+		GLState::bindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, staging.size(), nullptr, GL_DYNAMIC_DRAW);
+
+		GLState::bindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, UBO, 0, sizeof(CameraBlock));
+		GLState::bindBufferRange(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, UBO, lightsOffset, sizeof(LightsBlock));
+	}
+};
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include "../../dependencies/glad.h"
+
+#include <array>
+#include <iostream>
+
+// GL calls made through GLState in one frame, elided ones would have set what was already set
+struct GLStateStats {
+	unsigned int issued = 0;
+	unsigned int elided = 0;
+};
+
+// Thin cache over the state the renderer changes all the time: program, vertex array,
+// buffer and texture bindings, depth test and culling, viewport and framebuffer. A call
+// that would set what is already set is dropped. Code that changes this state behind its
+// back, or deletes objects that may be bound, has to call invalidate() afterwards.
+class GLState {
+
+public:
+	static const unsigned int TEXTURE_UNITS = 16;
+
+	static void useProgram(GLuint program) {
+		if (changed(state().program, program)) {
+			glUseProgram(program);
+		}
+	}
+
+	// The element buffer binding belongs to the vertex array, so it is unknown after a switch
+	static void bindVertexArray(GLuint vertexArray) {
+		if (changed(state().vertexArray, vertexArray)) {
+			glBindVertexArray(vertexArray);
+			state().elementBuffer = UNKNOWN;
+		}
+	}
+
+	static void bindBuffer(GLenum target, GLuint buffer) {
+		GLuint* cached = bufferBinding(target);
+		if (cached == nullptr) {
+			frame.issued++;
+			glBindBuffer(target, buffer);
+		} else if (changed(*cached, buffer)) {
+			glBindBuffer(target, buffer);
+		}
+	}
+
+	// Also binds buffer to the target's generic binding point, like GL does
+	static void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+		frame.issued++;
+		glBindBufferRange(target, index, buffer, offset, size);
+		GLuint* cached = bufferBinding(target);
+		if (cached != nullptr) {
+			*cached = buffer;
+		}
+	}
+
+	// Binds a 2D texture to unit, the active unit is only switched when the binding changes.
+	// Calls that edit the bound texture, e.g. glTexParameteri, need the unit to be active,
+	// which only a binding that was issued guarantees.
+	static void bindTexture(unsigned int unit, GLuint texture) {
+		if (unit >= TEXTURE_UNITS) {
+			frame.issued += 2;
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			state().activeUnit = unit;
+			return;
+		}
+
+		if (state().textures[unit] == texture) {
+			frame.elided++;
+			return;
+		}
+		if (changed(state().activeUnit, unit)) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+		state().textures[unit] = texture;
+		frame.issued++;
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
+
+	static void setEnabled(GLenum capability, bool enabled) {
+		int index = capabilityIndex(capability);
+		if (index >= 0 && !changed(state().capabilities[index], (int)enabled)) {
+			return;
+		}
+		if (index < 0) {
+			frame.issued++;
+		}
+		if (enabled) {
+			glEnable(capability);
+		} else {
+			glDisable(capability);
+		}
+	}
+
+	static void cullFace(GLenum mode) {
+		if (changed(state().cullFace, mode)) {
+			glCullFace(mode);
+		}
+	}
+
+	static void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+		if (changed(state().viewport, { x, y, width, height })) {
+			glViewport(x, y, width, height);
+		}
+	}
+
+	static void bindFramebuffer(GLuint framebuffer) {
+		if (changed(state().framebuffer, framebuffer)) {
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		}
+	}
+
+	// Forgets everything, the next call of each kind is issued
+	static void invalidate() {
+		state() = State();
+	}
+
+	// Closes the frame's counts, lastFrame() returns them until the next call
+	static void endFrame() {
+		previousFrame = frame;
+		frame = GLStateStats();
+	}
+
+	static const GLStateStats& lastFrame() {
+		return previousFrame;
+	}
+
+	static void printStats() {
+		std::cout << "GL state: " << previousFrame.issued << " calls issued, " << previousFrame.elided << " elided last frame" << std::endl;
+	}
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+	static const int CAPABILITIES = 3;
+
+	struct State {
+		GLuint program = UNKNOWN;
+		GLuint vertexArray = UNKNOWN;
+		GLuint arrayBuffer = UNKNOWN, elementBuffer = UNKNOWN, uniformBuffer = UNKNOWN;
+		GLuint activeUnit = UNKNOWN;
+		GLuint textures[TEXTURE_UNITS] = {
+			UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN,
+			UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN
+		};
+		int capabilities[CAPABILITIES] = { -1, -1, -1 };
+		GLenum cullFace = UNKNOWN;
+		std::array<GLint, 4> viewport = { -1, -1, -1, -1 };
+		GLuint framebuffer = UNKNOWN;
+	};
+
+	inline static GLStateStats frame, previousFrame;
+
+	static State& state() {
+		static State s;
+		return s;
+	}
+
+	template <typename T>
+	static bool changed(T& cached, const T& value) {
+		if (cached == value) {
+			frame.elided++;
+			return false;
+		}
+		cached = value;
+		frame.issued++;
+		return true;
+	}
+
+	static GLuint* bufferBinding(GLenum target) {
+		switch (target) {
+		case GL_ARRAY_BUFFER: return &state().arrayBuffer;
+		case GL_ELEMENT_ARRAY_BUFFER: return &state().elementBuffer;
+		case GL_UNIFORM_BUFFER: return &state().uniformBuffer;
+		default: return nullptr;
+		}
+	}
+
+	static int capabilityIndex(GLenum capability) {
+		switch (capability) {
+		case GL_DEPTH_TEST: return 0;
+		case GL_CULL_FACE: return 1;
+		case GL_BLEND: return 2;
+		default: return -1;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef INSTANCEDRENDERER_H
+#define INSTANCEDRENDERER_H
+
+#include "../Primitives/Primitive.cpp"
+#include "../TransformStore.cpp"
+#include "RenderQueue.cpp"
+
+#include "../../dependencies/glad.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Per-instance vertex attributes, read by the shaders at these locations
+const unsigned int INSTANCE_MODEL_LOCATION = 3; // mat4, takes locations 3 to 6
+const unsigned int INSTANCE_COLOR_LOCATION = 7;
+const unsigned int INSTANCE_NORMAL_MATRIX_LOCATION = 8; // mat3, takes locations 8 to 10
+
+struct InstanceData {
+	glm::mat4 model;
+	glm::vec3 color;
+	glm::mat3 normalMatrix;
+};
+
+// A run of instances that share mesh, shader and textures and are drawn with one call.
+// object is the index of the first scene object in the batch, used for its shared state.
+struct InstanceBatch {
+	unsigned int object;
+	unsigned int start;
+	unsigned int count;
+};
+
+// Groups consecutive scene objects of a sorted pass into batches and draws each batch with
+// a single instanced call.
+// The instance data of every batch lives in one buffer that is refilled each frame.
+class InstancedRenderer {
+
+public:
+	std::vector<InstanceData> instances;
+	std::vector<InstanceBatch> batches;
+
+	// Batches the items of one pass in their sorted order, see RenderQueue. Neighbours that
+	// share their state become one batch, with byMaterial false only the mesh is compared,
+	// which is all a depth pass needs.
+	void build(const std::vector<Primitive>& objects, std::pair<const RenderItem*, const RenderItem*> items, const TransformStore& transforms, bool byMaterial) {
+		instances.clear();
+		batches.clear();
+
+		for (const RenderItem* item = items.first; item != items.second; item++) {
+			const Primitive& object = objects[item->object];
+
+			if (batches.empty() || !sameState(objects[batches.back().object], object, byMaterial)) {
+				batches.push_back({ item->object, (unsigned int)instances.size(), 0 });
+			}
+
+			instances.push_back({ transforms.world[object.transformId], object.color, transforms.normal[object.transformId] });
+			batches.back().count++;
+		}
+
+		upload();
+	}
+
+	void draw(const InstanceBatch& batch, const Mesh& mesh) {
+		mesh.bind();
+		GLState::bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+		// GL 3.3 has no base instance, so the attributes point at the batch's first instance
+		size_t offset = batch.start * sizeof(InstanceData);
+		for (unsigned int i = 0; i < 4; i++) {
+			glVertexAttribPointer(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+				(void*)(offset + offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+			glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + i);
+			glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + i, 1);
+		}
+
+		glVertexAttribPointer(INSTANCE_COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(offset + offsetof(InstanceData, color)));
+		glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+		glVertexAttribDivisor(INSTANCE_COLOR_LOCATION, 1);
+
+		for (unsigned int i = 0; i < 3; i++) {
+			glVertexAttribPointer(INSTANCE_NORMAL_MATRIX_LOCATION + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+				(void*)(offset + offsetof(InstanceData, normalMatrix) + i * sizeof(glm::vec3)));
+			glEnableVertexAttribArray(INSTANCE_NORMAL_MATRIX_LOCATION + i);
+			glVertexAttribDivisor(INSTANCE_NORMAL_MATRIX_LOCATION + i, 1);
+		}
+
+		mesh.drawInstanced(batch.count);
+	}
+
+	// Sets the instance attributes of a VAO without instance arrays, e.g. the bounding box lines.
+	static void setConstantInstance(const glm::mat4& model, const glm::vec3& color, const glm::mat3& normalMatrix) {
+		for (unsigned int i = 0; i < 4; i++) {
+			glVertexAttrib4fv(INSTANCE_MODEL_LOCATION + i, &model[i][0]);
+		}
+		glVertexAttrib3fv(INSTANCE_COLOR_LOCATION, &color[0]);
+		for (unsigned int i = 0; i < 3; i++) {
+			glVertexAttrib3fv(INSTANCE_NORMAL_MATRIX_LOCATION + i, &normalMatrix[i][0]);
+		}
+	}
+
+private:
+	unsigned int instanceVBO = 0;
+
+	void upload() {
+		if (instanceVBO == 0) {
+			glGenBuffers(1, &instanceVBO);
+		}
+
+		// orphan last frame's storage instead of waiting for the GPU to finish with it
+		GLState::bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), instances.data(), GL_STREAM_DRAW);
+	}
+
+	static unsigned int textureOf(const unsigned int* map) {
+		return map != nullptr ? *map : 0;
+	}
+
+	// The keys can only tell this many programs, materials and meshes apart, so the batches
+	// compare the state itself
+	static bool sameState(const Primitive& a, const Primitive& b, bool byMaterial) {
+		unsigned int keyA[5] = { a.mesh.VAO, 0, 0, 0, 0 };
+		unsigned int keyB[5] = { b.mesh.VAO, 0, 0, 0, 0 };
+
+		if (byMaterial) {
+			keyA[1] = a.shader.ID;
+			keyA[2] = textureOf(a.diffuseMap);
+			keyA[3] = textureOf(a.specularMap);
+			keyA[4] = a.useSolidColor;
+
+			keyB[1] = b.shader.ID;
+			keyB[2] = textureOf(b.diffuseMap);
+			keyB[3] = textureOf(b.specularMap);
+			keyB[4] = b.useSolidColor;
+		}
+
+		for (int i = 0; i < 5; i++) {
+			if (keyA[i] != keyB[i]) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Passes in the order they are submitted, the top bits of every sort key
+enum RenderPass {
+	PASS_SHADOW,
+	PASS_COLOR,
+	PASS_COUNT
+};
+
+// object is the index of the scene object the key was made for
+struct RenderItem {
+	uint64_t key;
+	unsigned int object;
+};
+
+// State switches between consecutive items of one pass
+struct RenderQueueStats {
+	unsigned int items = 0;
+	unsigned int programChanges = 0;
+	unsigned int materialChanges = 0;
+	unsigned int meshChanges = 0;
+
+	unsigned int changes() const {
+		return programChanges + materialChanges + meshChanges;
+	}
+};
+
+// Draws of every pass as 64-bit sort keys, radix sorted once per frame so that each pass
+// is submitted in one contiguous run, grouped by the state that is most expensive to
+// switch. From the top bit down a key holds:
+//   pass (2) | depth layer (4) | program (10) | material (12) | mesh (14) | depth (22)
+// The depth layer is a coarse front to back order ahead of the state, so that close
+// occluders are drawn first and early depth testing rejects what they hide. Within
+// a state the fine depth orders the instances front to back as well. Programs,
+// materials and meshes are given dense ids the first time they are seen.
+class RenderQueue {
+
+public:
+	static const int DEPTH_BITS = 22;
+	static const int MESH_BITS = 14;
+	static const int MATERIAL_BITS = 12;
+	static const int PROGRAM_BITS = 10;
+	static const int LAYER_BITS = 4;
+
+	static const int MESH_SHIFT = DEPTH_BITS;
+	static const int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+	static const int PROGRAM_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+	static const int LAYER_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+	static const int PASS_SHIFT = LAYER_SHIFT + LAYER_BITS;
+
+	// depth goes from 0 at the viewer to 1 at the far plane, depthLayers of at most 16
+	// coarse layers are sorted ahead of the state, 1 sorts by state alone
+	static uint64_t key(RenderPass pass, unsigned int program, unsigned int material, unsigned int mesh, float depth, unsigned int depthLayers = 1) {
+		depth = std::min(std::max(depth, 0.0f), 1.0f);
+		uint64_t fine = (uint64_t)(depth * (float)mask(DEPTH_BITS));
+		uint64_t layer = std::min((uint64_t)(depth * depthLayers), (uint64_t)std::max(depthLayers, 1u) - 1);
+
+		return ((uint64_t)pass << PASS_SHIFT)
+			| (std::min(layer, mask(LAYER_BITS)) << LAYER_SHIFT)
+			| (std::min((uint64_t)program, mask(PROGRAM_BITS)) << PROGRAM_SHIFT)
+			| (std::min((uint64_t)material, mask(MATERIAL_BITS)) << MATERIAL_SHIFT)
+			| (std::min((uint64_t)mesh, mask(MESH_BITS)) << MESH_SHIFT)
+			| fine;
+	}
+
+	static unsigned int field(uint64_t key, int shift, int bits) {
+		return (unsigned int)((key >> shift) & mask(bits));
+	}
+
+	// Dense ids of GL programs, material settings and vertex arrays
+	unsigned int programId(unsigned int program) {
+		return denseId(programs, program);
+	}
+
+	unsigned int materialId(unsigned int diffuseMap, unsigned int specularMap, bool useSolidColor) {
+		return denseId(materials, ((uint64_t)diffuseMap << 32) | ((uint64_t)specularMap << 1) | useSolidColor);
+	}
+
+	unsigned int meshId(unsigned int vertexArray) {
+		return denseId(meshes, vertexArray);
+	}
+
+	void clear() {
+		items.clear();
+	}
+
+	void push(uint64_t key, unsigned int object) {
+		items.push_back({ key, object });
+	}
+
+	// Least significant digit first radix sort over bytes, stable so that equal keys keep
+	// the order they were pushed in. Bytes that are the same in every key are skipped.
+	void sort() {
+		countChanges(unsortedStats);
+
+		size_t count = items.size();
+		scratch.resize(count);
+
+		size_t histograms[8][256];
+		std::memset(histograms, 0, sizeof(histograms));
+		for (const RenderItem& item : items) {
+			for (int digit = 0; digit < 8; digit++) {
+				histograms[digit][(item.key >> (digit * 8)) & 0xff]++;
+			}
+		}
+
+		for (int digit = 0; digit < 8; digit++) {
+			size_t* histogram = histograms[digit];
+			if (histogram[(items.empty() ? 0 : items[0].key >> (digit * 8)) & 0xff] == count) {
+				continue;
+			}
+
+			size_t offsets[256];
+			size_t offset = 0;
+			for (int i = 0; i < 256; i++) {
+				offsets[i] = offset;
+				offset += histogram[i];
+			}
+
+			for (const RenderItem& item : items) {
+				scratch[offsets[(item.key >> (digit * 8)) & 0xff]++] = item;
+			}
+			items.swap(scratch);
+		}
+
+		countChanges(sortedStats);
+	}
+
+	// The sorted items of one pass
+	std::pair<const RenderItem*, const RenderItem*> pass(RenderPass pass) const {
+		auto begin = std::lower_bound(items.begin(), items.end(), (uint64_t)pass << PASS_SHIFT,
+			[](const RenderItem& item, uint64_t key) { return item.key < key; });
+		auto end = std::lower_bound(begin, items.end(), (uint64_t)(pass + 1) << PASS_SHIFT,
+			[](const RenderItem& item, uint64_t key) { return item.key < key; });
+		return { items.data() + (begin - items.begin()), items.data() + (end - items.begin()) };
+	}
+
+	// Switches of the last sorted frame, and how many the push order would have caused
+	const RenderQueueStats& stats(RenderPass pass) const {
+		return sortedStats[pass];
+	}
+
+	const RenderQueueStats& unsorted(RenderPass pass) const {
+		return unsortedStats[pass];
+	}
+
+private:
+	std::vector<RenderItem> items, scratch;
+	std::unordered_map<uint64_t, unsigned int> programs, materials, meshes;
+
+	RenderQueueStats sortedStats[PASS_COUNT], unsortedStats[PASS_COUNT];
+
+	static uint64_t mask(int bits) {
+		return ((uint64_t)1 << bits) - 1;
+	}
+
+	static unsigned int denseId(std::unordered_map<uint64_t, unsigned int>& ids, uint64_t value) {
+		return ids.emplace(value, (unsigned int)ids.size()).first->second;
+	}
+
+	// The first item of a pass counts as a change of everything, it has to set all of it
+	void countChanges(RenderQueueStats* counted) const {
+		std::fill(counted, counted + PASS_COUNT, RenderQueueStats());
+		const RenderItem* previous = nullptr;
+		for (const RenderItem& item : items) {
+			unsigned int pass = field(item.key, PASS_SHIFT, 64 - PASS_SHIFT);
+			if (pass >= PASS_COUNT) {
+				continue;
+			}
+			RenderQueueStats& stats = counted[pass];
+			bool first = previous == nullptr || field(previous->key, PASS_SHIFT, 64 - PASS_SHIFT) != pass;
+
+			stats.items++;
+			stats.programChanges += first || changed(*previous, item, PROGRAM_SHIFT, PROGRAM_BITS);
+			stats.materialChanges += first || changed(*previous, item, MATERIAL_SHIFT, MATERIAL_BITS);
+			stats.meshChanges += first || changed(*previous, item, MESH_SHIFT, MESH_BITS);
+			previous = &item;
+		}
+	}
+
+	static bool changed(const RenderItem& a, const RenderItem& b, int shift, int bits) {
+		return field(a.key, shift, bits) != field(b.key, shift, bits);
+	}
+};
+
+#endif
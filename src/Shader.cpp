@@ -3,164 +3,388 @@
 
 #include "../dependencies/glad.h"
 #include "glm/glm.hpp"
+#include "ProgramBinaryCache.cpp"
+#include "ShaderPreprocessor.cpp"
+#include "Rendering/GLState.cpp"
 
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+// Fixed binding points of the uniform blocks shared between programs,
+// see Rendering/FrameUniforms.cpp for their contents
+const unsigned int CAMERA_BLOCK_BINDING = 0;
+const unsigned int LIGHTS_BLOCK_BINDING = 1;
+
+// Location of an active uniform, resolved once through Shader::uniform
+struct UniformHandle
+{
+    int location = -1;
+
+    bool valid() const
+    {
+        return location >= 0;
+    }
+};
 
 class Shader
 {
 public:
     unsigned int ID;
 
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    // No program, for primitives built without a GL context (see Primitive::headless)
+    Shader() : ID(0)
     {
+    }
 
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
+    // Every stage is run through the ShaderPreprocessor with the same defines
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const ShaderDefines& defines = ShaderDefines())
+    {
+        std::string vertexCode = loadSource(vertexPath, defines);
+        std::string fragmentCode = loadSource(fragmentPath, defines);
+        std::string geometryCode = geometryPath != nullptr ? loadSource(geometryPath, defines) : "";
 
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
+        build(vertexCode, fragmentCode, geometryCode, false);
+    }
 
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
+    // Builds a program from sources that were already read, e.g. by the ShaderLoader, an empty
+    // geometryCode means no geometry stage. With deferStatus the compile and link are only
+    // submitted and their status is checked on first use, so the driver can work on many
+    // programs at once instead of stalling after each.
+    static Shader fromSource(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode = "", bool deferStatus = false)
+    {
+        Shader shader;
+        shader.build(vertexCode, fragmentCode, geometryCode, deferStatus);
+        return shader;
+    }
 
-            vShaderFile.close();
-            fShaderFile.close();
+    static std::string readFile(const char* path)
+    {
+        std::string text;
+        if (!ShaderPreprocessor::readFile(path, text))
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return text;
+    }
 
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+    // The file with its includes expanded and the defines inserted
+    static std::string loadSource(const char* path, const ShaderDefines& defines = ShaderDefines())
+    {
+        return ShaderPreprocessor::process(readFile(path), path, defines);
+    }
 
-            if (geometryPath != nullptr)
-            {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+    // Lets the driver compile on as many threads as it likes when it has
+    // KHR_parallel_shader_compile (or the ARB version), load resolves the extension's entry point
+    static void enableParallelCompile(GLADloadproc load)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            std::string name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            const char* function = nullptr;
+            if (name == "GL_KHR_parallel_shader_compile")
+                function = "glMaxShaderCompilerThreadsKHR";
+            else if (name == "GL_ARB_parallel_shader_compile")
+                function = "glMaxShaderCompilerThreadsARB";
+            else
+                continue;
+
+            typedef void (APIENTRYP MaxShaderCompilerThreads)(GLuint count);
+            MaxShaderCompilerThreads maxThreads = (MaxShaderCompilerThreads)load(function);
+            if (maxThreads != nullptr)
+                maxThreads(0xFFFFFFFF);
+            parallelCompile = true;
+            return;
         }
-        catch (std::ifstream::failure& e)
+    }
+
+    // Whether the program can be used without waiting for the driver. Without parallel
+    // compile support asking would wait, so a pending program reports ready.
+    bool ready() const
+    {
+        if (!state->pending || !parallelCompile)
+            return true;
+
+        GLint complete = GL_FALSE;
+        glGetProgramiv(ID, COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+    void use()
+    {
+        finishLink();
+        GLState::useProgram(ID);
+    }
+
+    // Looks the name up in the table built after linking. Names that are not active
+    // uniforms are reported the first time they are asked for and give an invalid
+    // handle, which the setters ignore like GL ignores location -1.
+    UniformHandle uniform(const std::string& name) const
+    {
+        finishLink();
+        UniformHandle handle;
+        auto it = state->locations.find(name);
+        if (it != state->locations.end())
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            handle.location = it->second;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        unsigned int vertex, fragment;
-
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if (geometryPath != nullptr)
+        else if (state->reported.insert(name).second)
         {
-            const char* gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            std::cout << "WARNING::SHADER::UNIFORM_NOT_FOUND: " << name << std::endl;
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if (geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if (geometryPath != nullptr)
-            glDeleteShader(geometry);
+        return handle;
     }
 
-    void use()
+    void setBool(UniformHandle handle, bool value) const
+    {
+        glUniform1i(handle.location, (int)value);
+    }
+
+    void setInt(UniformHandle handle, int value) const
     {
-        glUseProgram(ID);
+        glUniform1i(handle.location, value);
+    }
+
+    void setFloat(UniformHandle handle, float value) const
+    {
+        glUniform1f(handle.location, value);
+    }
+
+    void setVec2(UniformHandle handle, const glm::vec2& value) const
+    {
+        glUniform2fv(handle.location, 1, &value[0]);
+    }
+
+    void setVec3(UniformHandle handle, const glm::vec3& value) const
+    {
+        glUniform3fv(handle.location, 1, &value[0]);
+    }
+
+    void setVec4(UniformHandle handle, const glm::vec4& value) const
+    {
+        glUniform4fv(handle.location, 1, &value[0]);
+    }
+
+    void setMat2(UniformHandle handle, const glm::mat2& mat) const
+    {
+        glUniformMatrix2fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+
+    void setMat3(UniformHandle handle, const glm::mat3& mat) const
+    {
+        glUniformMatrix3fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+
+    void setMat4(UniformHandle handle, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(handle.location, 1, GL_FALSE, &mat[0][0]);
     }
 
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setBool(uniform(name), value);
     }
 
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        setInt(uniform(name), value);
     }
 
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        setFloat(uniform(name), value);
     }
 
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec2(uniform(name), value);
     }
 
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(uniform(name).location, x, y);
     }
 
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec3(uniform(name), value);
     }
 
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(uniform(name).location, x, y, z);
     }
 
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec4(uniform(name), value);
     }
 
     void setVec4(const std::string& name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(uniform(name).location, x, y, z, w);
     }
 
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(uniform(name), mat);
     }
 
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(uniform(name), mat);
     }
 
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(uniform(name), mat);
     }
 
 private:
-    void checkCompileErrors(GLuint shader, std::string type)
+    // From GL_KHR_parallel_shader_compile, which the generated loader does not include
+    static const GLenum COMPLETION_STATUS_KHR = 0x91B1;
+
+    inline static bool parallelCompile = false;
+
+    // Shared between copies of the shader, which all refer to the same program
+    struct ProgramState
+    {
+        std::unordered_map<std::string, int> locations;
+        std::unordered_set<std::string> reported;
+
+        // a deferred build waiting for its status check, with the stages to check
+        bool pending = false;
+        unsigned int stages[3] = {};
+        int stageCount = 0;
+        uint64_t cacheKey = 0;
+    };
+
+    std::shared_ptr<ProgramState> state = std::make_shared<ProgramState>();
+
+    void build(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode, bool deferStatus)
+    {
+        // a program linked from the same sources on an earlier run is loaded as is, a missing
+        // or rejected binary falls back to compiling into the same program object
+        state->cacheKey = ProgramBinaryCache::key({ vertexCode, fragmentCode, geometryCode });
+        ProgramBinary binary;
+        bool cached = ProgramBinaryCache::read(state->cacheKey, binary);
+        ID = glCreateProgram();
+        if (cached && ProgramBinaryCache::load(state->cacheKey, binary, ID))
+        {
+            reflectUniforms();
+            bindUniformBlocks();
+            return;
+        }
+
+        const std::string* codes[3] = { &vertexCode, &fragmentCode, &geometryCode };
+        const GLenum types[3] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+        for (int i = 0; i < 3; i++)
+        {
+            if (i == 2 && geometryCode.empty())
+                break;
+
+            const char* code = codes[i]->c_str();
+            unsigned int stage = glCreateShader(types[i]);
+            glShaderSource(stage, 1, &code, NULL);
+            glCompileShader(stage);
+            glAttachShader(ID, stage);
+            state->stages[state->stageCount++] = stage;
+        }
+
+        ProgramBinaryCache::prepare(ID);
+        glLinkProgram(ID);
+
+        state->pending = true;
+        if (!deferStatus)
+            finishLink();
+    }
+
+    // Checks the status of a deferred build, waiting for the driver if it is not done yet,
+    // and does what needs the linked program. Copies share the state, so this runs once.
+    void finishLink() const
+    {
+        if (!state->pending)
+            return;
+        state->pending = false;
+
+        static const char* stageNames[3] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+        for (int i = 0; i < state->stageCount; i++)
+            checkCompileErrors(state->stages[i], stageNames[i]);
+        checkCompileErrors(ID, "PROGRAM");
+
+        ProgramBinaryCache::store(state->cacheKey, ID);
+        reflectUniforms();
+        bindUniformBlocks();
+
+        for (int i = 0; i < state->stageCount; i++)
+            glDeleteShader(state->stages[i]);
+        state->stageCount = 0;
+    }
+
+    void reflectUniforms() const
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::string name(maxLength, '\0');
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+            std::string uniformName = name.substr(0, length);
+
+            int location = glGetUniformLocation(ID, uniformName.c_str());
+            // uniforms inside blocks have no location
+            if (location < 0)
+                continue;
+
+            state->locations[uniformName] = location;
+
+            // arrays of basic types are reported once as "name[0]", add every element
+            // and the bare name, which GL also accepts for the first element
+            size_t bracket = uniformName.rfind("[0]");
+            if (bracket != std::string::npos && bracket + 3 == uniformName.size())
+            {
+                std::string base = uniformName.substr(0, bracket);
+                state->locations[base] = location;
+                for (GLint j = 1; j < size; j++)
+                {
+                    std::string element = base + "[" + std::to_string(j) + "]";
+                    state->locations[element] = glGetUniformLocation(ID, element.c_str());
+                }
+            }
+        }
+    }
+
+    // Blocks are bound by name, so every program sees the same per-frame buffers
+    void bindUniformBlocks() const
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+
+        std::string name(maxLength, '\0');
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            glGetActiveUniformBlockName(ID, i, maxLength, &length, &name[0]);
+            std::string blockName = name.substr(0, length);
+
+            if (blockName == "Camera")
+                glUniformBlockBinding(ID, i, CAMERA_BLOCK_BINDING);
+            else if (blockName == "Lights")
+                glUniformBlockBinding(ID, i, LIGHTS_BLOCK_BINDING);
+            else
+                std::cout << "WARNING::SHADER::UNKNOWN_UNIFORM_BLOCK: " << blockName << std::endl;
+        }
+    }
+
+    void checkCompileErrors(GLuint shader, std::string type) const
     {
         GLint success;
         GLchar infoLog[1024];
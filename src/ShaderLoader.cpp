@@ -0,0 +1,48 @@
+#ifndef SHADERLOADER_H
+#define SHADERLOADER_H
+
+#include "Shader.cpp"
+#include "ThreadPool.cpp"
+
+#include <string>
+#include <vector>
+
+struct ShaderFiles {
+	const char* vertexPath;
+	const char* fragmentPath;
+	const char* geometryPath = nullptr;
+	ShaderDefines defines{};
+};
+
+// Builds many programs at once: the files are read and preprocessed on the pool's threads,
+// then every compile and link is submitted before any status is asked for. The status of each program
+// is only checked when it is first used, so with parallel shader compile the driver works
+// on all of them while the caller goes on, e.g. loading textures.
+class ShaderLoader {
+
+public:
+	// programs[i] is built from requests[i]
+	static std::vector<Shader> load(const std::vector<ShaderFiles>& requests, ThreadPool& pool) {
+		std::vector<std::string> sources(requests.size() * 3);
+		pool.parallelFor(requests.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				const ShaderFiles& files = requests[i];
+				sources[i * 3] = Shader::loadSource(files.vertexPath, files.defines);
+				sources[i * 3 + 1] = Shader::loadSource(files.fragmentPath, files.defines);
+				if (files.geometryPath != nullptr) {
+					sources[i * 3 + 2] = Shader::loadSource(files.geometryPath, files.defines);
+				}
+			}
+		});
+
+		// GL calls stay on the thread that owns the context
+		std::vector<Shader> programs;
+		programs.reserve(requests.size());
+		for (size_t i = 0; i < requests.size(); i++) {
+			programs.push_back(Shader::fromSource(sources[i * 3], sources[i * 3 + 1], sources[i * 3 + 2], true));
+		}
+		return programs;
+	}
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef SHADERPREPROCESSOR_H
+#define SHADERPREPROCESSOR_H
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Macros injected into every stage of a program, in name order so that equal sets give
+// equal text and with it the same program (see ShaderVariants)
+struct ShaderDefines {
+	std::map<std::string, std::string> values;
+
+	ShaderDefines& set(const std::string& name, const std::string& value) {
+		values[name] = value;
+		return *this;
+	}
+
+	ShaderDefines& set(const std::string& name, int value) {
+		return set(name, std::to_string(value));
+	}
+
+	std::string text() const {
+		std::string lines;
+		for (const auto& define : values) {
+			lines += "#define " + define.first + " " + define.second + "\n";
+		}
+		return lines;
+	}
+};
+
+// Expands #include "file" lines, relative to the including file, and inserts the defines
+// right after #version. Every file is included once per stage, like with #pragma once, and
+// includes are expanded whether or not they sit in a disabled #if. #line directives keep
+// the driver's error lines pointing into the original files, source string 0 is the stage's
+// own file and the included ones are numbered in the order they were first included.
+class ShaderPreprocessor {
+
+public:
+	static bool readFile(const std::string& path, std::string& text) {
+		std::ifstream file(path);
+		if (!file) {
+			return false;
+		}
+		std::stringstream stream;
+		stream << file.rdbuf();
+		text = stream.str();
+		return true;
+	}
+
+	// source was read from path, which the includes are resolved against
+	static std::string process(const std::string& source, const std::string& path, const ShaderDefines& defines = ShaderDefines()) {
+		std::vector<std::string> included = { normalized(path) };
+		std::string out;
+		expand(source, path, 0, defines.text(), included, out);
+		return out;
+	}
+
+private:
+	// Included files are shared by most programs and all their permutations, so each is
+	// read from disk once. The ShaderLoader preprocesses on several threads at a time.
+	inline static std::unordered_map<std::string, std::string> includeCache;
+	inline static std::mutex includeMutex;
+
+	static bool readInclude(const std::string& path, std::string& text) {
+		std::lock_guard<std::mutex> lock(includeMutex);
+		auto it = includeCache.find(path);
+		if (it == includeCache.end()) {
+			if (!readFile(path, text)) {
+				return false;
+			}
+			it = includeCache.emplace(path, text).first;
+		}
+		text = it->second;
+		return true;
+	}
+
+	static std::string normalized(const std::filesystem::path& path) {
+		return path.lexically_normal().generic_string();
+	}
+
+	static void expand(const std::string& source, const std::filesystem::path& path, size_t sourceNumber,
+		const std::string& defines, std::vector<std::string>& included, std::string& out) {
+		std::istringstream lines(source);
+		std::string line;
+		int lineNumber = 0;
+		bool definesWritten = defines.empty() || sourceNumber != 0;
+		if (!definesWritten && source.find("#version") == std::string::npos) {
+			// nothing has to stay in front of them
+			out += defines + "#line 1 0\n";
+			definesWritten = true;
+		}
+
+		while (std::getline(lines, line)) {
+			lineNumber++;
+			size_t start = line.find_first_not_of(" \t");
+			std::string directive = start != std::string::npos ? line.substr(start) : "";
+
+			if (directive.compare(0, 8, "#version") == 0 && !definesWritten) {
+				out += line + "\n" + defines + "#line " + std::to_string(lineNumber + 1) + " 0\n";
+				definesWritten = true;
+				continue;
+			}
+
+			if (directive.compare(0, 8, "#include") != 0) {
+				out += line + "\n";
+				continue;
+			}
+
+			size_t open = directive.find('"');
+			size_t close = open != std::string::npos ? directive.find('"', open + 1) : std::string::npos;
+			if (close == std::string::npos) {
+				std::cout << "ERROR::SHADER::MALFORMED_INCLUDE: " << path.generic_string() << "(" << lineNumber << ")" << std::endl;
+				out += "\n";
+				continue;
+			}
+
+			std::filesystem::path file = path.parent_path() / directive.substr(open + 1, close - open - 1);
+			std::string name = normalized(file);
+			bool seen = false;
+			for (const std::string& other : included) {
+				seen = seen || other == name;
+			}
+
+			std::string text;
+			if (seen) {
+				out += "\n";
+			} else if (!readInclude(name, text)) {
+				std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << name << " in " << path.generic_string() << std::endl;
+				out += "\n";
+			} else {
+				size_t number = included.size();
+				included.push_back(name);
+				out += "#line 1 " + std::to_string(number) + "\n";
+				expand(text, file, number, defines, included, out);
+				out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceNumber) + "\n";
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include "Shader.cpp"
+#include "ShaderLoader.cpp"
+#include "ThreadPool.cpp"
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The permutations of one shader, e.g. per light count or with and without textures, each
+// compiled with its own defines so the program has no branches for the other cases. A
+// permutation is built the first time it is asked for, objects asking for the same
+// defines share its program. Builds go through the ShaderLoader on pool.
+class ShaderVariants {
+
+public:
+	ShaderVariants(ThreadPool& pool, const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+		: pool(pool), vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath != nullptr ? geometryPath : "") {
+	}
+
+	// Builds the permutations not built yet in one ShaderLoader batch, so their sources are
+	// preprocessed in parallel and the driver gets every compile before any status check
+	void prepare(const std::vector<ShaderDefines>& permutations) {
+		std::vector<ShaderFiles> requests;
+		std::vector<std::string> keys;
+		for (const ShaderDefines& defines : permutations) {
+			std::string key = defines.text();
+			bool queued = false;
+			for (const std::string& other : keys) {
+				queued = queued || other == key;
+			}
+			if (queued || programs.count(key) != 0) {
+				continue;
+			}
+			keys.push_back(key);
+			requests.push_back({ vertexPath.c_str(), fragmentPath.c_str(), geometryPath.empty() ? nullptr : geometryPath.c_str(), defines });
+		}
+
+		if (requests.empty()) {
+			return;
+		}
+		std::vector<Shader> built = ShaderLoader::load(requests, pool);
+		for (size_t i = 0; i < built.size(); i++) {
+			programs.emplace(keys[i], built[i]);
+		}
+	}
+
+	// The compile is only submitted here, its status is checked when the program is first used
+	Shader get(const ShaderDefines& defines) {
+		requests++;
+		std::string key = defines.text();
+		auto it = programs.find(key);
+		if (it == programs.end()) {
+			prepare({ defines });
+			it = programs.find(key);
+		}
+		return it->second;
+	}
+
+	size_t size() const {
+		return programs.size();
+	}
+
+	void printStats() const {
+		std::cout << "Shader variants of " << fragmentPath << ": " << programs.size() << " built for " << requests << " requests" << std::endl;
+	}
+
+private:
+	ThreadPool& pool;
+	std::string vertexPath, fragmentPath, geometryPath;
+	std::unordered_map<std::string, Shader> programs;
+	unsigned int requests = 0;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Axis aligned box in world space, the bounds every spatial structure works with
+struct AABB {
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+	AABB() {}
+
+	AABB(glm::vec3 min, glm::vec3 max) : min(min), max(max) {}
+
+	// World bounds of the local box [minVert, maxVert] under transformation
+	static AABB fromTransformedBox(const glm::vec3& minVert, const glm::vec3& maxVert, const glm::mat4& transformation) {
+		glm::vec3 center = (minVert + maxVert) * 0.5f;
+		glm::vec3 extent = (maxVert - minVert) * 0.5f;
+
+		glm::vec3 worldCenter = glm::vec3(transformation * glm::vec4(center, 1.0f));
+		glm::vec3 worldExtent(0.0f);
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				worldExtent[i] += std::fabs(transformation[j][i]) * extent[j];
+			}
+		}
+
+		return AABB(worldCenter - worldExtent, worldCenter + worldExtent);
+	}
+
+	static AABB merge(const AABB& a, const AABB& b) {
+		return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+	}
+
+	void expand(const AABB& other) {
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	void expand(const glm::vec3& point) {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	bool overlaps(const AABB& other) const {
+		return min.x <= other.max.x && max.x >= other.min.x &&
+			min.y <= other.max.y && max.y >= other.min.y &&
+			min.z <= other.max.z && max.z >= other.min.z;
+	}
+
+	bool contains(const AABB& other) const {
+		return min.x <= other.min.x && max.x >= other.max.x &&
+			min.y <= other.min.y && max.y >= other.max.y &&
+			min.z <= other.min.z && max.z >= other.max.z;
+	}
+
+	// Slab test of origin + t * direction for t in [0, maxDistance], given 1 / direction.
+	// On a hit distance is where the ray enters the box, 0 when it starts inside.
+	bool intersectsRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& distance) const {
+		glm::vec3 t1 = (min - origin) * inverseDirection;
+		glm::vec3 t2 = (max - origin) * inverseDirection;
+		glm::vec3 near = glm::min(t1, t2);
+		glm::vec3 far = glm::max(t1, t2);
+
+		float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+		float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+
+		distance = enter;
+		return enter <= exit;
+	}
+
+	bool operator==(const AABB& other) const {
+		return min == other.min && max == other.max;
+	}
+
+	glm::vec3 center() const {
+		return (min + max) * 0.5f;
+	}
+
+	glm::vec3 extent() const {
+		return (max - min) * 0.5f;
+	}
+
+	float surfaceArea() const {
+		glm::vec3 d = max - min;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+};
+
+#endif
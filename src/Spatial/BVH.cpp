@@ -0,0 +1,166 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "AABB.cpp"
+#include "Frustum.cpp"
+
+#include <algorithm>
+#include <vector>
+
+struct BVHNode {
+	AABB bounds;
+	int left = -1, right = -1; // -1 for leaves
+	int parent = -1;
+	// every node covers a contiguous range of the object list
+	unsigned int start = 0, count = 0;
+
+	bool isLeaf() const {
+		return left < 0;
+	}
+};
+
+// Bounding volume hierarchy over the world bounds of the scene objects, used to find the
+// objects inside a view frustum. Built top-down with median splits and refitted in place
+// when objects move, so only the moved objects' paths to the root are touched.
+class BVH {
+
+public:
+	static const unsigned int MAX_LEAF_OBJECTS = 4;
+
+	void build(const std::vector<AABB>& bounds) {
+		nodes.clear();
+		objects.resize(bounds.size());
+		leafOf.assign(bounds.size(), -1);
+
+		for (unsigned int i = 0; i < objects.size(); i++) {
+			objects[i] = i;
+		}
+
+		if (!bounds.empty()) {
+			nodes.reserve(2 * bounds.size() / MAX_LEAF_OBJECTS + 1);
+			buildNode(bounds, 0, bounds.size(), -1);
+		}
+	}
+
+	// Updates the bounds of the changed objects and of the nodes above them.
+	void refit(const std::vector<AABB>& bounds, const std::vector<unsigned int>& changed) {
+		if (bounds.size() != objects.size()) {
+			build(bounds);
+			return;
+		}
+
+		for (unsigned int id : changed) {
+			int node = leafOf[id];
+
+			AABB leafBounds;
+			for (unsigned int i = nodes[node].start; i < nodes[node].start + nodes[node].count; i++) {
+				leafBounds.expand(bounds[objects[i]]);
+			}
+			nodes[node].bounds = leafBounds;
+
+			for (node = nodes[node].parent; node >= 0; node = nodes[node].parent) {
+				AABB merged = AABB::merge(nodes[nodes[node].left].bounds, nodes[nodes[node].right].bounds);
+				if (merged == nodes[node].bounds) {
+					// nothing above this node changes either
+					break;
+				}
+				nodes[node].bounds = merged;
+			}
+		}
+	}
+
+	// Appends the objects whose bounds are at least partly inside the frustum
+	void query(const Frustum& frustum, const std::vector<AABB>& bounds, std::vector<unsigned int>& visible) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+		stack.clear();
+		stack.push_back(0);
+
+		while (!stack.empty()) {
+			const BVHNode& node = nodes[stack.back()];
+			stack.pop_back();
+
+			FrustumTest result = frustum.test(node.bounds);
+			if (result == OUTSIDE) {
+				continue;
+			}
+
+			// everything below a node inside the frustum is visible without further tests
+			if (result == INSIDE) {
+				visible.insert(visible.end(), objects.begin() + node.start, objects.begin() + node.start + node.count);
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				for (unsigned int i = node.start; i < node.start + node.count; i++) {
+					if (frustum.test(bounds[objects[i]]) != OUTSIDE) {
+						visible.push_back(objects[i]);
+					}
+				}
+				continue;
+			}
+
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+
+	size_t objectCount() const {
+		return objects.size();
+	}
+
+	size_t nodeCount() const {
+		return nodes.size();
+	}
+
+private:
+	std::vector<BVHNode> nodes;
+	std::vector<unsigned int> objects;
+	std::vector<int> leafOf;
+	mutable std::vector<int> stack;
+
+	int buildNode(const std::vector<AABB>& bounds, unsigned int start, unsigned int end, int parent) {
+		int index = nodes.size();
+		nodes.push_back(BVHNode());
+		nodes[index].parent = parent;
+		nodes[index].start = start;
+		nodes[index].count = end - start;
+
+		AABB nodeBounds, centroidBounds;
+		for (unsigned int i = start; i < end; i++) {
+			nodeBounds.expand(bounds[objects[i]]);
+			centroidBounds.expand(bounds[objects[i]].center());
+		}
+		nodes[index].bounds = nodeBounds;
+
+		if (end - start <= MAX_LEAF_OBJECTS) {
+			for (unsigned int i = start; i < end; i++) {
+				leafOf[objects[i]] = index;
+			}
+			return index;
+		}
+
+		// split at the median along the axis the centroids spread the most
+		glm::vec3 spread = centroidBounds.max - centroidBounds.min;
+		int axis = 0;
+		if (spread.y > spread[axis]) axis = 1;
+		if (spread.z > spread[axis]) axis = 2;
+
+		unsigned int middle = start + (end - start) / 2;
+		std::nth_element(objects.begin() + start, objects.begin() + middle, objects.begin() + end,
+			[&](unsigned int a, unsigned int b) {
+				return bounds[a].center()[axis] < bounds[b].center()[axis];
+			});
+
+		int left = buildNode(bounds, start, middle, index);
+		int right = buildNode(bounds, middle, end, index);
+		nodes[index].left = left;
+		nodes[index].right = right;
+
+		return index;
+	}
+};
+
+#endif
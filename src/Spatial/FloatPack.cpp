@@ -0,0 +1,71 @@
+#ifndef FLOATPACK_H
+#define FLOATPACK_H
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLOAT_PACK_SSE2
+#endif
+
+// SIMD float packs with the handful of operations the collision and ray kernels need.
+// All of them have the same interface, so each kernel is written once as a template and
+// FloatPack is the widest one the compiler targets.
+struct ScalarPack {
+	static const int WIDTH = 1;
+	float v;
+
+	static ScalarPack load(const float* p) { return { *p }; }
+	static ScalarPack set(float x) { return { x }; }
+	static void store(float* p, ScalarPack a) { *p = a.v; }
+	friend ScalarPack operator+(ScalarPack a, ScalarPack b) { return { a.v + b.v }; }
+	friend ScalarPack operator-(ScalarPack a, ScalarPack b) { return { a.v - b.v }; }
+	friend ScalarPack operator*(ScalarPack a, ScalarPack b) { return { a.v * b.v }; }
+	static ScalarPack abs(ScalarPack a) { return { std::fabs(a.v) }; }
+	static ScalarPack min(ScalarPack a, ScalarPack b) { return { a.v < b.v ? a.v : b.v }; }
+	static ScalarPack max(ScalarPack a, ScalarPack b) { return { a.v > b.v ? a.v : b.v }; }
+	// bit i set when lane i of a is greater than lane i of b
+	static unsigned int greater(ScalarPack a, ScalarPack b) { return a.v > b.v ? 1u : 0u; }
+};
+
+#if defined(__AVX2__)
+struct AVXPack {
+	static const int WIDTH = 8;
+	__m256 v;
+
+	static AVXPack load(const float* p) { return { _mm256_loadu_ps(p) }; }
+	static AVXPack set(float x) { return { _mm256_set1_ps(x) }; }
+	static void store(float* p, AVXPack a) { _mm256_storeu_ps(p, a.v); }
+	friend AVXPack operator+(AVXPack a, AVXPack b) { return { _mm256_add_ps(a.v, b.v) }; }
+	friend AVXPack operator-(AVXPack a, AVXPack b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	friend AVXPack operator*(AVXPack a, AVXPack b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	static AVXPack abs(AVXPack a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+	static AVXPack min(AVXPack a, AVXPack b) { return { _mm256_min_ps(a.v, b.v) }; }
+	static AVXPack max(AVXPack a, AVXPack b) { return { _mm256_max_ps(a.v, b.v) }; }
+	static unsigned int greater(AVXPack a, AVXPack b) { return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+};
+typedef AVXPack FloatPack;
+#elif defined(FLOAT_PACK_SSE2)
+struct SSEPack {
+	static const int WIDTH = 4;
+	__m128 v;
+
+	static SSEPack load(const float* p) { return { _mm_loadu_ps(p) }; }
+	static SSEPack set(float x) { return { _mm_set1_ps(x) }; }
+	static void store(float* p, SSEPack a) { _mm_storeu_ps(p, a.v); }
+	friend SSEPack operator+(SSEPack a, SSEPack b) { return { _mm_add_ps(a.v, b.v) }; }
+	friend SSEPack operator-(SSEPack a, SSEPack b) { return { _mm_sub_ps(a.v, b.v) }; }
+	friend SSEPack operator*(SSEPack a, SSEPack b) { return { _mm_mul_ps(a.v, b.v) }; }
+	static SSEPack abs(SSEPack a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+	static SSEPack min(SSEPack a, SSEPack b) { return { _mm_min_ps(a.v, b.v) }; }
+	static SSEPack max(SSEPack a, SSEPack b) { return { _mm_max_ps(a.v, b.v) }; }
+	static unsigned int greater(SSEPack a, SSEPack b) { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, b.v)); }
+};
+typedef SSEPack FloatPack;
+#else
+typedef ScalarPack FloatPack;
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "AABB.cpp"
+
+#include <glm/glm.hpp>
+
+enum FrustumTest {
+	OUTSIDE,
+	INTERSECTING,
+	INSIDE
+};
+
+// The six planes of a view volume, taken from a projection * view matrix. Works for
+// the perspective camera as well as the orthographic light projection.
+struct Frustum {
+	// xyz is the inward normal, w the distance, so a point p is inside when dot(n, p) + w >= 0
+	glm::vec4 planes[6];
+
+	Frustum() {}
+
+	explicit Frustum(const glm::mat4& viewProjection) {
+		glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		planes[0] = row3 + row0; // left
+		planes[1] = row3 - row0; // right
+		planes[2] = row3 + row1; // bottom
+		planes[3] = row3 - row1; // top
+		planes[4] = row3 + row2; // near
+		planes[5] = row3 - row2; // far
+
+		for (int i = 0; i < 6; i++) {
+			planes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+		}
+	}
+
+	FrustumTest test(const AABB& box) const {
+		glm::vec3 center = box.center();
+		glm::vec3 extent = box.extent();
+		FrustumTest result = INSIDE;
+
+		for (int i = 0; i < 6; i++) {
+			glm::vec3 normal = glm::vec3(planes[i]);
+			float distance = glm::dot(normal, center) + planes[i].w;
+			float radius = glm::dot(glm::abs(normal), extent);
+
+			if (distance < -radius) {
+				return OUTSIDE;
+			}
+			if (distance < radius) {
+				result = INTERSECTING;
+			}
+		}
+
+		return result;
+	}
+};
+
+#endif
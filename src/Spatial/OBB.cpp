@@ -0,0 +1,207 @@
+#ifndef OBB_H
+#define OBB_H
+
+#include "AABB.cpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+// Oriented box as center, half extents along its own axes and the rotation whose
+// columns are those unit axes. Plain data, so colliders are stored contiguously and
+// copied without allocations. Corners are only derived for the debug lines.
+struct OBB {
+	glm::vec3 center;
+	glm::vec3 halfExtents;
+	glm::mat3 rotation;
+
+	// Added to the rotation terms of the SAT so that nearly parallel edges, whose cross
+	// product vanishes, cannot produce a false separating axis
+	static constexpr float EPSILON = 1e-5f;
+
+	static OBB fromMinMax(const glm::vec3& minVert, const glm::vec3& maxVert) {
+		OBB box;
+		box.center = (minVert + maxVert) * 0.5f;
+		box.halfExtents = (maxVert - minVert) * 0.5f;
+		box.rotation = glm::mat3(1.0f);
+		return box;
+	}
+
+	// This box under an affine transformation, whose scale moves from the axes into the extents
+	OBB transformed(const glm::mat4& transformation) const {
+		OBB box;
+		box.center = glm::vec3(transformation * glm::vec4(center, 1.0f));
+
+		glm::mat3 linear = glm::mat3(transformation) * rotation;
+		for (int i = 0; i < 3; i++) {
+			float length = glm::length(linear[i]);
+			box.rotation[i] = length > 0.0f ? linear[i] / length : glm::vec3(0.0f);
+			box.halfExtents[i] = halfExtents[i] * length;
+		}
+
+		return box;
+	}
+
+	OBB translated(const glm::vec3& delta) const {
+		OBB box = *this;
+		box.center += delta;
+		return box;
+	}
+
+	AABB bounds() const {
+		glm::vec3 extent(0.0f);
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				extent[i] += std::fabs(rotation[j][i]) * halfExtents[j];
+			}
+		}
+		return AABB(center - extent, center + extent);
+	}
+
+	// Slab test in the box's frame. On a hit distance is where the ray enters the box and
+	// normal the face it enters through, a ray starting inside hits at 0 facing back.
+	bool intersectsRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, glm::vec3& normal) const {
+		glm::vec3 localOrigin = (origin - center) * rotation;
+		glm::vec3 localDirection = direction * rotation;
+
+		float enter = 0.0f, exit = maxDistance;
+		int enterAxis = -1;
+		for (int i = 0; i < 3; i++) {
+			if (std::fabs(localDirection[i]) < 1e-12f) {
+				if (std::fabs(localOrigin[i]) > halfExtents[i]) {
+					return false;
+				}
+				continue;
+			}
+
+			float inverse = 1.0f / localDirection[i];
+			float t1 = (-halfExtents[i] - localOrigin[i]) * inverse;
+			float t2 = (halfExtents[i] - localOrigin[i]) * inverse;
+			if (t1 > t2) {
+				std::swap(t1, t2);
+			}
+
+			if (t1 > enter) {
+				enter = t1;
+				enterAxis = i;
+			}
+			exit = std::min(exit, t2);
+			if (enter > exit) {
+				return false;
+			}
+		}
+
+		distance = enter;
+		if (enterAxis < 0) {
+			normal = -direction;
+		} else {
+			normal = localDirection[enterAxis] > 0.0f ? -rotation[enterAxis] : rotation[enterAxis];
+		}
+		return true;
+	}
+
+	// 15 axis separating axis test, done in this box's frame
+	bool intersects(const OBB& other) const {
+		return separatingAxis(other) < 0;
+	}
+
+	// Index of the first of the 15 axes that separates the boxes, -1 when they overlap.
+	// 0-2 are this box's axes, 3-5 the other's and 6 + i * 3 + j the cross product of
+	// this box's axis i with the other's axis j, see axis().
+	int separatingAxis(const OBB& other) const {
+		float R[3][3], AR[3][3];
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				R[i][j] = glm::dot(rotation[i], other.rotation[j]);
+				AR[i][j] = std::fabs(R[i][j]) + EPSILON;
+			}
+		}
+
+		glm::vec3 d = other.center - center;
+		float t[3] = { glm::dot(d, rotation[0]), glm::dot(d, rotation[1]), glm::dot(d, rotation[2]) };
+		const glm::vec3& e = halfExtents;
+		const glm::vec3& f = other.halfExtents;
+
+		for (int i = 0; i < 3; i++) {
+			if (std::fabs(t[i]) > e[i] + f[0] * AR[i][0] + f[1] * AR[i][1] + f[2] * AR[i][2]) {
+				return i;
+			}
+		}
+
+		for (int j = 0; j < 3; j++) {
+			float distance = t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j];
+			if (std::fabs(distance) > e[0] * AR[0][j] + e[1] * AR[1][j] + e[2] * AR[2][j] + f[j]) {
+				return 3 + j;
+			}
+		}
+
+		for (int i = 0; i < 3; i++) {
+			int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+			for (int j = 0; j < 3; j++) {
+				int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+				float ra = e[i1] * AR[i2][j] + e[i2] * AR[i1][j];
+				float rb = f[j1] * AR[i][j2] + f[j2] * AR[i][j1];
+				if (std::fabs(t[i2] * R[i1][j] - t[i1] * R[i2][j]) > ra + rb) {
+					return 6 + i * 3 + j;
+				}
+			}
+		}
+
+		return -1;
+	}
+
+	// World space unit vector of a separatingAxis() index
+	glm::vec3 axis(int index, const OBB& other) const {
+		if (index < 3) {
+			return rotation[index];
+		}
+		if (index < 6) {
+			return other.rotation[index - 3];
+		}
+
+		glm::vec3 cross = glm::cross(rotation[(index - 6) / 3], other.rotation[(index - 6) % 3]);
+		float length = glm::length(cross);
+		// parallel edges never separate, see EPSILON, but keep the axis usable
+		return length > 1e-6f ? cross / length : rotation[(index - 6) / 3];
+	}
+
+	// Gap between the boxes' projections onto the unit vector axis, negative when the
+	// projections overlap
+	float separation(const OBB& other, const glm::vec3& axis) const {
+		float distance = std::fabs(glm::dot(other.center - center, axis));
+		for (int i = 0; i < 3; i++) {
+			distance -= halfExtents[i] * std::fabs(glm::dot(rotation[i], axis));
+			distance -= other.halfExtents[i] * std::fabs(glm::dot(other.rotation[i], axis));
+		}
+		return distance;
+	}
+
+	// Corner positions for the debug lines, front face (+z) first, counter clockwise from
+	// bottom left, then the back face in the same order
+	std::vector<float> cornerVertices() const {
+		static const float signs[8][3] = {
+			{-1, -1,  1}, { 1, -1,  1}, { 1,  1,  1}, {-1,  1,  1},
+			{-1, -1, -1}, { 1, -1, -1}, { 1,  1, -1}, {-1,  1, -1}
+		};
+
+		std::vector<float> vertices;
+		vertices.reserve(24);
+		for (int i = 0; i < 8; i++) {
+			glm::vec3 corner = center;
+			for (int j = 0; j < 3; j++) {
+				corner += rotation[j] * (signs[i][j] * halfExtents[j]);
+			}
+			vertices.push_back(corner.x);
+			vertices.push_back(corner.y);
+			vertices.push_back(corner.z);
+		}
+		return vertices;
+	}
+};
+
+static_assert(std::is_trivially_copyable<OBB>::value, "OBB must stay plain data");
+static_assert(sizeof(OBB) == 15 * sizeof(float), "OBB must stay 60 bytes");
+
+#endif
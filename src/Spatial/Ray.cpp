@@ -0,0 +1,85 @@
+#ifndef RAY_H
+#define RAY_H
+
+#include "FloatPack.cpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+struct Ray {
+	glm::vec3 origin;
+	glm::vec3 direction; // unit length, so distances along the ray are world distances
+	float maxDistance = INFINITY;
+
+	Ray() {}
+
+	Ray(glm::vec3 origin, glm::vec3 direction, float maxDistance = INFINITY)
+		: origin(origin), direction(direction), maxDistance(maxDistance) {}
+};
+
+// Up to FloatPack::WIDTH rays stored as separate coordinate arrays, so a hierarchy node is
+// tested against all of them at once. maxDistance shrinks as closer hits are found.
+struct RayPacket {
+	static const int WIDTH = FloatPack::WIDTH;
+
+	float originX[WIDTH], originY[WIDTH], originZ[WIDTH];
+	float inverseX[WIDTH], inverseY[WIDTH], inverseZ[WIDTH];
+	float maxDistance[WIDTH];
+	unsigned int active = 0; // bit i set for the lanes that hold a ray
+
+	// Takes the first count rays, at most WIDTH, the other lanes stay inactive
+	RayPacket(const Ray* rays, size_t count) {
+		for (int i = 0; i < WIDTH; i++) {
+			const Ray& ray = rays[i < (int)count ? i : 0];
+			originX[i] = ray.origin.x; originY[i] = ray.origin.y; originZ[i] = ray.origin.z;
+			inverseX[i] = 1.0f / ray.direction.x;
+			inverseY[i] = 1.0f / ray.direction.y;
+			inverseZ[i] = 1.0f / ray.direction.z;
+			maxDistance[i] = ray.maxDistance;
+			if (i < (int)count) {
+				active |= 1u << i;
+			}
+		}
+	}
+
+	// Bit i set for the rays that pass through the box before their maxDistance. nearest is
+	// set to the smallest distance at which one of them enters the box.
+	unsigned int intersects(const float min[3], const float max[3], float& nearest) const {
+		typedef FloatPack P;
+		P t1x = (P::set(min[0]) - P::load(originX)) * P::load(inverseX);
+		P t2x = (P::set(max[0]) - P::load(originX)) * P::load(inverseX);
+		P t1y = (P::set(min[1]) - P::load(originY)) * P::load(inverseY);
+		P t2y = (P::set(max[1]) - P::load(originY)) * P::load(inverseY);
+		P t1z = (P::set(min[2]) - P::load(originZ)) * P::load(inverseZ);
+		P t2z = (P::set(max[2]) - P::load(originZ)) * P::load(inverseZ);
+
+		P enter = P::max(P::max(P::min(t1x, t2x), P::min(t1y, t2y)), P::max(P::min(t1z, t2z), P::set(0.0f)));
+		P exit = P::min(P::min(P::max(t1x, t2x), P::max(t1y, t2y)), P::min(P::max(t1z, t2z), P::load(maxDistance)));
+
+		unsigned int mask = ~P::greater(enter, exit) & active;
+		float entries[WIDTH];
+		P::store(entries, enter);
+		nearest = INFINITY;
+		for (int i = 0; i < WIDTH; i++) {
+			if (mask & (1u << i)) {
+				nearest = std::min(nearest, entries[i]);
+			}
+		}
+		return mask;
+	}
+
+	// Largest maxDistance of the active rays, a box entered beyond it is missed by all of them
+	float farthest() const {
+		float distance = 0.0f;
+		for (int i = 0; i < WIDTH; i++) {
+			if (active & (1u << i)) {
+				distance = std::max(distance, maxDistance[i]);
+			}
+		}
+		return distance;
+	}
+};
+
+#endif
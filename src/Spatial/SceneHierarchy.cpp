@@ -0,0 +1,98 @@
+#ifndef SCENEHIERARCHY_H
+#define SCENEHIERARCHY_H
+
+#include "BVH.cpp"
+#include "StaticBVH.cpp"
+
+#include <iostream>
+#include <vector>
+
+// Culling hierarchy of the scene: objects that never move are baked into a StaticBVH,
+// the moving ones live in a small refitted BVH on top of it. Queries walk both and
+// report scene object indices, per frame work only depends on the moving objects.
+class SceneHierarchy {
+
+public:
+	// dynamicObjects[id] is nonzero for the objects that may move
+	void build(const std::vector<AABB>& bounds, const std::vector<unsigned char>& dynamicObjects) {
+		std::vector<unsigned int> staticIds;
+		dynamicIds.clear();
+		dynamicIndex.assign(bounds.size(), -1);
+
+		for (unsigned int id = 0; id < bounds.size(); id++) {
+			if (dynamicObjects[id]) {
+				dynamicIndex[id] = dynamicIds.size();
+				dynamicIds.push_back(id);
+			} else {
+				staticIds.push_back(id);
+			}
+		}
+
+		staticTree.build(bounds, staticIds);
+
+		dynamicBounds.resize(dynamicIds.size());
+		for (unsigned int i = 0; i < dynamicIds.size(); i++) {
+			dynamicBounds[i] = bounds[dynamicIds[i]];
+		}
+		dynamicTree.build(dynamicBounds);
+
+		objectCount = bounds.size();
+		flags = dynamicObjects;
+	}
+
+	// Refits the dynamic tree for the changed objects. A changed static object means it was
+	// wrongly marked static, the static tree is rebuilt so that culling stays correct.
+	void update(const std::vector<AABB>& bounds, const std::vector<unsigned int>& changed) {
+		changedLocal.clear();
+		bool staticChanged = false;
+
+		for (unsigned int id : changed) {
+			if (dynamicIndex[id] < 0) {
+				staticChanged = true;
+				continue;
+			}
+			dynamicBounds[dynamicIndex[id]] = bounds[id];
+			changedLocal.push_back(dynamicIndex[id]);
+		}
+
+		if (staticChanged) {
+			std::cout << "WARNING::SCENE_HIERARCHY: a static object moved, rebuilding the static BVH" << std::endl;
+			build(bounds, flags);
+			return;
+		}
+
+		dynamicTree.refit(dynamicBounds, changedLocal);
+	}
+
+	// Appends the objects whose bounds are at least partly inside the frustum
+	void query(const Frustum& frustum, const std::vector<AABB>& bounds, std::vector<unsigned int>& visible) const {
+		staticTree.query(frustum, bounds, visible);
+
+		size_t first = visible.size();
+		dynamicTree.query(frustum, dynamicBounds, visible);
+		for (size_t i = first; i < visible.size(); i++) {
+			visible[i] = dynamicIds[visible[i]];
+		}
+	}
+
+	size_t size() const {
+		return objectCount;
+	}
+
+	size_t dynamicCount() const {
+		return dynamicIds.size();
+	}
+
+private:
+	StaticBVH staticTree;
+	BVH dynamicTree;
+
+	std::vector<unsigned int> dynamicIds; // object index of each dynamic tree entry
+	std::vector<int> dynamicIndex;        // dynamic tree entry of each object, -1 if static
+	std::vector<AABB> dynamicBounds;
+	std::vector<unsigned int> changedLocal;
+	std::vector<unsigned char> flags;
+	size_t objectCount = 0;
+};
+
+#endif
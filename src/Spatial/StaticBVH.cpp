@@ -0,0 +1,402 @@
+#ifndef STATICBVH_H
+#define STATICBVH_H
+
+#include "AABB.cpp"
+#include "Frustum.cpp"
+#include "Ray.cpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// 32 bytes, two nodes per cache line. Interior nodes are followed by their first child,
+// offset is the index of the second. Leaves list count items starting at offset.
+struct alignas(32) StaticBVHNode {
+	float min[3];
+	uint32_t offset;
+	float max[3];
+	uint32_t count; // 0 for interior nodes
+
+	bool isLeaf() const {
+		return count > 0;
+	}
+
+	AABB bounds() const {
+		return AABB(glm::vec3(min[0], min[1], min[2]), glm::vec3(max[0], max[1], max[2]));
+	}
+
+	bool overlaps(const AABB& box) const {
+		return min[0] <= box.max.x && max[0] >= box.min.x &&
+			min[1] <= box.max.y && max[1] >= box.min.y &&
+			min[2] <= box.max.z && max[2] >= box.min.z;
+	}
+};
+
+static_assert(sizeof(StaticBVHNode) == 32, "StaticBVHNode must stay 32 bytes");
+
+// Immutable hierarchy over objects that never move, built once with binned surface area
+// heuristic splits and stored depth first in one array. Queries read it without any
+// per frame maintenance, a changed object requires a new build.
+class StaticBVH {
+
+public:
+	static const unsigned int BIN_COUNT = 12;
+	static const unsigned int MAX_LEAF_ITEMS = 4;
+	// Bounds the traversal stacks, deeper nodes become leaves
+	static const unsigned int MAX_DEPTH = 48;
+
+	// Builds over the objects listed in ids, whose bounds are bounds[id]
+	void build(const std::vector<AABB>& bounds, const std::vector<unsigned int>& ids) {
+		nodes.clear();
+		items = ids;
+		itemBounds.clear();
+		if (items.empty()) {
+			return;
+		}
+
+		centroids.resize(bounds.size());
+		for (unsigned int id : items) {
+			centroids[id] = bounds[id].center();
+		}
+
+		nodes.reserve(2 * items.size());
+		buildNode(bounds, 0, items.size(), 0);
+
+		centroids.clear();
+		centroids.shrink_to_fit();
+
+		itemBounds.resize(items.size());
+		for (size_t i = 0; i < items.size(); i++) {
+			itemBounds[i] = bounds[items[i]];
+		}
+	}
+
+	// Calls callback(id) for the objects whose bounds may overlap box, stops early when
+	// the callback returns false. Only leaf bounds are tested, not those of every item.
+	template <typename Callback>
+	bool query(const AABB& box, Callback callback) const {
+		if (nodes.empty()) {
+			return true;
+		}
+
+		uint32_t stack[MAX_DEPTH + 2];
+		int top = 0;
+		stack[top++] = 0;
+
+		while (top > 0) {
+			const StaticBVHNode& node = nodes[stack[--top]];
+			if (!node.overlaps(box)) {
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+					if (!callback(items[i])) {
+						return false;
+					}
+				}
+			} else {
+				stack[top++] = node.offset;
+				stack[top++] = (uint32_t)(&node - nodes.data()) + 1;
+			}
+		}
+
+		return true;
+	}
+
+	// Visits the items of the leaves a ray passes through, nearer child first.
+	// hit(item, maxDistance) tests an item and lowers maxDistance when it finds a closer
+	// hit, which prunes the nodes behind it.
+	template <typename Hit>
+	void raycast(const glm::vec3& origin, const glm::vec3& direction, float& maxDistance, Hit hit) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+		glm::vec3 inverseDirection = 1.0f / direction;
+		float entry;
+		if (!nodes[0].bounds().intersectsRay(origin, inverseDirection, maxDistance, entry)) {
+			return;
+		}
+
+		struct Entry {
+			uint32_t node;
+			float distance;
+		};
+		Entry stack[MAX_DEPTH + 2];
+		int top = 0;
+		stack[top++] = { 0, entry };
+
+		while (top > 0) {
+			Entry current = stack[--top];
+			if (current.distance > maxDistance) {
+				continue;
+			}
+
+			const StaticBVHNode& node = nodes[current.node];
+			if (node.isLeaf()) {
+				for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+					hit(items[i], maxDistance);
+				}
+				continue;
+			}
+
+			uint32_t first = current.node + 1, second = node.offset;
+			float firstDistance, secondDistance;
+			bool hitFirst = nodes[first].bounds().intersectsRay(origin, inverseDirection, maxDistance, firstDistance);
+			bool hitSecond = nodes[second].bounds().intersectsRay(origin, inverseDirection, maxDistance, secondDistance);
+
+			// the nearer child goes on top of the stack
+			if (hitFirst && hitSecond && firstDistance > secondDistance) {
+				std::swap(first, second);
+				std::swap(firstDistance, secondDistance);
+			}
+			if (hitFirst && hitSecond) {
+				stack[top++] = { second, secondDistance };
+				stack[top++] = { first, firstDistance };
+			} else if (hitFirst) {
+				stack[top++] = { first, firstDistance };
+			} else if (hitSecond) {
+				stack[top++] = { second, secondDistance };
+			}
+		}
+	}
+
+	// Traverses the tree once for a whole packet of rays. hit(item, mask) tests an item
+	// against the rays in mask and lowers their packet.maxDistance on closer hits. Like the
+	// single ray walk, the child the packet enters first is visited first, and a node is
+	// skipped once every ray's closest hit lies before the packet enters it.
+	template <typename Hit>
+	void raycast(RayPacket& packet, Hit hit) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+		float entry;
+		unsigned int rootMask = packet.intersects(nodes[0].min, nodes[0].max, entry);
+		if (rootMask == 0) {
+			return;
+		}
+
+		// mask holds the rays that entered the node when it was pushed
+		struct Entry {
+			uint32_t node;
+			unsigned int mask;
+			float distance;
+		};
+		Entry stack[MAX_DEPTH + 2];
+		int top = 0;
+		stack[top++] = { 0, rootMask, entry };
+
+		while (top > 0) {
+			Entry current = stack[--top];
+			if (current.distance > packet.farthest()) {
+				continue;
+			}
+
+			const StaticBVHNode& node = nodes[current.node];
+			if (node.isLeaf()) {
+				// each item only gets the rays that enter its own bounds before their closest hit
+				for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+					float entry;
+					unsigned int mask = packet.intersects(&itemBounds[i].min.x, &itemBounds[i].max.x, entry);
+					if (mask != 0) {
+						hit(items[i], mask);
+					}
+				}
+				continue;
+			}
+
+			Entry first = { current.node + 1, 0, 0.0f }, second = { node.offset, 0, 0.0f };
+			first.mask = packet.intersects(nodes[first.node].min, nodes[first.node].max, first.distance);
+			second.mask = packet.intersects(nodes[second.node].min, nodes[second.node].max, second.distance);
+
+			// the child entered first goes on top of the stack
+			if (first.mask != 0 && second.mask != 0 && first.distance > second.distance) {
+				std::swap(first, second);
+			}
+			if (second.mask != 0) {
+				stack[top++] = second;
+			}
+			if (first.mask != 0) {
+				stack[top++] = first;
+			}
+		}
+	}
+
+	// Appends the objects whose bounds are at least partly inside the frustum
+	void query(const Frustum& frustum, const std::vector<AABB>& bounds, std::vector<unsigned int>& visible) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+		// the high bit marks nodes below a node that was fully inside, they need no test
+		const uint32_t INSIDE_BIT = 0x80000000u;
+		uint32_t stack[MAX_DEPTH + 2];
+		int top = 0;
+		stack[top++] = 0;
+
+		while (top > 0) {
+			uint32_t entry = stack[--top];
+			uint32_t index = entry & ~INSIDE_BIT;
+			const StaticBVHNode& node = nodes[index];
+
+			FrustumTest result = INSIDE;
+			if (!(entry & INSIDE_BIT)) {
+				result = frustum.test(node.bounds());
+				if (result == OUTSIDE) {
+					continue;
+				}
+			}
+
+			if (node.isLeaf()) {
+				for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+					if (result == INSIDE || frustum.test(bounds[items[i]]) != OUTSIDE) {
+						visible.push_back(items[i]);
+					}
+				}
+			} else {
+				uint32_t flag = result == INSIDE ? INSIDE_BIT : 0;
+				stack[top++] = node.offset | flag;
+				stack[top++] = (index + 1) | flag;
+			}
+		}
+	}
+
+	size_t nodeCount() const {
+		return nodes.size();
+	}
+
+	size_t itemCount() const {
+		return items.size();
+	}
+
+	size_t memoryUsage() const {
+		return nodes.size() * sizeof(StaticBVHNode) + items.size() * (sizeof(unsigned int) + sizeof(AABB));
+	}
+
+private:
+	std::vector<StaticBVHNode> nodes;
+	std::vector<unsigned int> items;
+	std::vector<AABB> itemBounds; // bounds of items[i], for the packet walk
+	std::vector<glm::vec3> centroids; // only during the build
+
+	struct Bin {
+		AABB bounds;
+		unsigned int count = 0;
+	};
+
+	void buildNode(const std::vector<AABB>& bounds, unsigned int start, unsigned int end, unsigned int depth) {
+		unsigned int index = nodes.size();
+		nodes.push_back(StaticBVHNode());
+
+		AABB nodeBounds, centroidBounds;
+		for (unsigned int i = start; i < end; i++) {
+			nodeBounds.expand(bounds[items[i]]);
+			centroidBounds.expand(centroids[items[i]]);
+		}
+		for (int i = 0; i < 3; i++) {
+			nodes[index].min[i] = nodeBounds.min[i];
+			nodes[index].max[i] = nodeBounds.max[i];
+		}
+
+		unsigned int count = end - start;
+		int axis;
+		unsigned int middle;
+		if (count <= MAX_LEAF_ITEMS || depth == MAX_DEPTH || !findSplit(bounds, start, end, nodeBounds, centroidBounds, axis, middle)) {
+			nodes[index].offset = start;
+			nodes[index].count = count;
+			return;
+		}
+
+		nodes[index].count = 0;
+		buildNode(bounds, start, middle, depth + 1);
+		nodes[index].offset = nodes.size();
+		buildNode(bounds, middle, end, depth + 1);
+	}
+
+	// Picks the bin boundary with the lowest surface area cost and partitions the items by it.
+	// Returns false when keeping the items in one leaf is cheaper than any split.
+	bool findSplit(const std::vector<AABB>& bounds, unsigned int start, unsigned int end,
+		const AABB& nodeBounds, const AABB& centroidBounds, int& bestAxis, unsigned int& middle) {
+
+		float bestCost = INFINITY;
+		unsigned int bestBin = 0;
+		bestAxis = -1;
+
+		for (int axis = 0; axis < 3; axis++) {
+			float low = centroidBounds.min[axis];
+			float extent = centroidBounds.max[axis] - low;
+			if (extent <= 0.0f) {
+				continue;
+			}
+
+			Bin bins[BIN_COUNT];
+			float scale = BIN_COUNT / extent;
+			for (unsigned int i = start; i < end; i++) {
+				Bin& bin = bins[binOf(centroids[items[i]][axis], low, scale)];
+				bin.bounds.expand(bounds[items[i]]);
+				bin.count++;
+			}
+
+			// areas and counts left of each boundary, then sweep from the right
+			float leftArea[BIN_COUNT - 1];
+			unsigned int leftCount[BIN_COUNT - 1];
+			AABB accumulated;
+			unsigned int total = 0;
+			for (unsigned int b = 0; b < BIN_COUNT - 1; b++) {
+				if (bins[b].count > 0) {
+					accumulated.expand(bins[b].bounds);
+				}
+				total += bins[b].count;
+				leftArea[b] = total > 0 ? accumulated.surfaceArea() : 0.0f;
+				leftCount[b] = total;
+			}
+
+			accumulated = AABB();
+			total = 0;
+			for (unsigned int b = BIN_COUNT - 1; b > 0; b--) {
+				if (bins[b].count > 0) {
+					accumulated.expand(bins[b].bounds);
+				}
+				total += bins[b].count;
+
+				if (leftCount[b - 1] == 0 || total == 0) {
+					continue;
+				}
+				float cost = leftArea[b - 1] * leftCount[b - 1] + accumulated.surfaceArea() * total;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+
+		// traversing a node costs about as much as testing one item
+		float leafCost = nodeBounds.surfaceArea() * (end - start);
+		float splitCost = nodeBounds.surfaceArea() + bestCost;
+		if (bestAxis < 0 || (splitCost >= leafCost && end - start <= 2 * MAX_LEAF_ITEMS)) {
+			return false;
+		}
+
+		float low = centroidBounds.min[bestAxis];
+		float scale = BIN_COUNT / (centroidBounds.max[bestAxis] - low);
+		unsigned int* first = items.data() + start;
+		unsigned int* last = items.data() + end;
+		unsigned int* split = std::partition(first, last, [&](unsigned int id) {
+			return binOf(centroids[id][bestAxis], low, scale) < bestBin;
+		});
+		middle = start + (unsigned int)(split - first);
+
+		return middle != start && middle != end;
+	}
+
+	static unsigned int binOf(float value, float low, float scale) {
+		int bin = (int)((value - low) * scale);
+		return (unsigned int)std::max(0, std::min((int)BIN_COUNT - 1, bin));
+	}
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data parallel loops. parallelFor hands out chunks of an
+// index range through an atomic counter, the calling thread works along and returns once
+// every chunk is done. Meant to be driven from one thread at a time.
+class ThreadPool {
+
+public:
+	// threadCount counts the calling thread, so 1 runs everything inline
+	explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency()) {
+		for (unsigned int i = 1; i < std::max(threadCount, 1u); i++) {
+			workers.emplace_back([this]() { work(); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Calls body(begin, end) for consecutive ranges of at most grain indices covering [0, count)
+	template <typename Body>
+	void parallelFor(size_t count, size_t grain, Body body) {
+		if (count == 0) {
+			return;
+		}
+		grain = std::max(grain, (size_t)1);
+
+		if (workers.empty() || count <= grain) {
+			body(0, count);
+			return;
+		}
+
+		std::function<void(size_t, size_t)> function = body;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &function;
+			jobCount = count;
+			jobGrain = grain;
+			next = 0;
+			finished = 0;
+			generation++;
+		}
+		wake.notify_all();
+
+		runChunks();
+
+		// every worker has to be done with this job before the next one replaces it
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this]() { return finished == workers.size(); });
+		job = nullptr;
+	}
+
+	unsigned int threadCount() const {
+		return workers.size() + 1;
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+
+	const std::function<void(size_t, size_t)>* job = nullptr;
+	size_t jobCount = 0, jobGrain = 1;
+	std::atomic<size_t> next{ 0 };
+	size_t finished = 0;
+	size_t generation = 0;
+	bool stopping = false;
+
+	void work() {
+		size_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]() { return stopping || generation != seen; });
+				if (stopping) {
+					return;
+				}
+				seen = generation;
+			}
+
+			runChunks();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (++finished == workers.size()) {
+				done.notify_one();
+			}
+		}
+	}
+
+	void runChunks() {
+		for (size_t begin = next.fetch_add(jobGrain); begin < jobCount; begin = next.fetch_add(jobGrain)) {
+			(*job)(begin, std::min(begin + jobGrain, jobCount));
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef TRANSFORMSTORE_H
+#define TRANSFORMSTORE_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+
+// Translation, rotation and scale of every scene object, kept as separate arrays so
+// that the matrices of all changed objects are rebuilt in one tight loop per frame.
+// The model matrix is translate * scale * rotateX * rotateY * rotateZ and it is the
+// only one both render passes and the collision boxes read.
+class TransformStore {
+
+public:
+	std::vector<glm::mat4> world;
+	std::vector<glm::mat3> normal;
+
+	// Ids whose world matrix was rebuilt by the last update
+	std::vector<unsigned int> changed;
+
+	unsigned int add(glm::vec3 translation, glm::vec3 rotation, glm::vec3 scale) {
+		unsigned int id = dirty.size();
+
+		tx.push_back(translation.x); ty.push_back(translation.y); tz.push_back(translation.z);
+		rx.push_back(rotation.x); ry.push_back(rotation.y); rz.push_back(rotation.z);
+		sx.push_back(scale.x); sy.push_back(scale.y); sz.push_back(scale.z);
+		dirty.push_back(1);
+		dirtyIds.push_back(id);
+
+		world.push_back(glm::mat4(1.0f));
+		normal.push_back(glm::mat3(1.0f));
+
+		return id;
+	}
+
+	void setTranslation(unsigned int id, glm::vec3 translation) {
+		tx[id] = translation.x; ty[id] = translation.y; tz[id] = translation.z;
+		markDirty(id);
+	}
+
+	void setRotation(unsigned int id, glm::vec3 rotation) {
+		rx[id] = rotation.x; ry[id] = rotation.y; rz[id] = rotation.z;
+		markDirty(id);
+	}
+
+	void setScale(unsigned int id, glm::vec3 scale) {
+		sx[id] = scale.x; sy[id] = scale.y; sz[id] = scale.z;
+		markDirty(id);
+	}
+
+	glm::vec3 getTranslation(unsigned int id) const {
+		return glm::vec3(tx[id], ty[id], tz[id]);
+	}
+
+	size_t size() const {
+		return dirty.size();
+	}
+
+	// Rebuilds world and normal matrices of dirty objects. The setters list the objects
+	// they dirty, so a frame in which nothing moved does no work at all.
+	void update() {
+		changed.swap(dirtyIds);
+		dirtyIds.clear();
+		for (unsigned int id : changed) {
+			dirty[id] = 0;
+		}
+
+		computeMatrices();
+	}
+
+private:
+	std::vector<float> tx, ty, tz;
+	std::vector<float> rx, ry, rz;
+	std::vector<float> sx, sy, sz;
+	std::vector<unsigned char> dirty;
+	std::vector<unsigned int> dirtyIds; // the ids flagged in dirty, in the order they were set
+
+	void markDirty(unsigned int id) {
+		if (!dirty[id]) {
+			dirty[id] = 1;
+			dirtyIds.push_back(id);
+		}
+	}
+
+	// scratch arrays of the batch, one entry per changed object
+	std::vector<float> sinX, cosX, sinY, cosY, sinZ, cosZ;
+
+	void computeMatrices() {
+		size_t count = changed.size();
+		sinX.resize(count); cosX.resize(count);
+		sinY.resize(count); cosY.resize(count);
+		sinZ.resize(count); cosZ.resize(count);
+
+		for (size_t k = 0; k < count; k++) {
+			unsigned int i = changed[k];
+			sinX[k] = std::sin(rx[i]); cosX[k] = std::cos(rx[i]);
+			sinY[k] = std::sin(ry[i]); cosY[k] = std::cos(ry[i]);
+			sinZ[k] = std::sin(rz[i]); cosZ[k] = std::cos(rz[i]);
+		}
+
+		for (size_t k = 0; k < count; k++) {
+			unsigned int i = changed[k];
+			float sa = sinX[k], ca = cosX[k];
+			float sb = sinY[k], cb = cosY[k];
+			float sc = sinZ[k], cc = cosZ[k];
+
+			// rows of rotateX(a) * rotateY(b) * rotateZ(c)
+			float r00 = cb * cc,                 r01 = -cb * sc,                r02 = sb;
+			float r10 = sa * sb * cc + ca * sc,  r11 = -sa * sb * sc + ca * cc, r12 = -sa * cb;
+			float r20 = -ca * sb * cc + sa * sc, r21 = ca * sb * sc + sa * cc,  r22 = ca * cb;
+
+			// world = T * S * R, stored column major
+			glm::mat4& m = world[i];
+			m[0] = glm::vec4(sx[i] * r00, sy[i] * r10, sz[i] * r20, 0.0f);
+			m[1] = glm::vec4(sx[i] * r01, sy[i] * r11, sz[i] * r21, 0.0f);
+			m[2] = glm::vec4(sx[i] * r02, sy[i] * r12, sz[i] * r22, 0.0f);
+			m[3] = glm::vec4(tx[i], ty[i], tz[i], 1.0f);
+
+			// transpose(inverse(S * R)) = inverse(S) * R
+			float ix = 1.0f / sx[i], iy = 1.0f / sy[i], iz = 1.0f / sz[i];
+			glm::mat3& n = normal[i];
+			n[0] = glm::vec3(ix * r00, iy * r10, iz * r20);
+			n[1] = glm::vec3(ix * r01, iy * r11, iz * r21);
+			n[2] = glm::vec3(ix * r02, iy * r12, iz * r22);
+		}
+	}
+};
+
+#endif
@@ -11,7 +11,10 @@
 #include "../dependencies/stb_image.h"
 
 #include "Shader.cpp"
+#include "ShaderLoader.cpp"
+#include "ShaderVariants.cpp"
 #include "Camera.cpp"
+#include "TransformStore.cpp"
 #include "Primitives/Triangle.cpp"
 #include "Primitives/Quad.cpp"
 #include "Primitives/Circle.cpp"
@@ -19,16 +22,26 @@
 #include "Primitives/Sphere.cpp"
 #include "Lights/DirectionalLight.cpp"
 #include "Lights/PointLight.cpp"
+#include "Rendering/InstancedRenderer.cpp"
+#include "Rendering/FrameUniforms.cpp"
+#include "Rendering/GLState.cpp"
+#include "Rendering/RenderQueue.cpp"
+#include "Spatial/SceneHierarchy.cpp"
+#include "Collision/CollisionWorld.cpp"
 
 
 // functions
-void buildScene(std::vector<Primitive> &sceneObjects, std::vector<PointLight> &pointLights, DirectionalLight &dirLight, std::vector<unsigned int> &textureStorage);
-void buildShadowMap(std::vector<Primitive> &sceneObjects, glm::mat4 lightSpaceMatrix, Shader depthShader, unsigned int &depthMapFBO);
-void renderScene(std::vector<Primitive> &sceneObjects, std::vector<PointLight> &pointLights, DirectionalLight dirLight, glm::mat4 lightSpaceMatrix, unsigned int &depthMap);
+void buildScene(std::vector<Primitive> &sceneObjects, std::vector<PointLight> &pointLights, DirectionalLight &dirLight, std::vector<unsigned int> &textureStorage,
+    ShaderVariants &lightingVariants, const Shader &normalShader);
+void queuePass(RenderQueue &queue, RenderPass pass, const std::vector<Primitive> &sceneObjects, const std::vector<unsigned int> &visible,
+    const glm::vec3 &eye, const glm::vec3 &forward, float farPlane);
+void buildShadowMap(std::vector<Primitive> &sceneObjects, const RenderQueue &queue, Shader depthShader, unsigned int &depthMapFBO);
+void renderScene(std::vector<Primitive> &sceneObjects, const RenderQueue &queue, unsigned int &depthMap, Shader highlightShader);
 void renderDebugQuad(unsigned int depthMap);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
-void processInput(GLFWwindow* window, std::vector<Primitive> objects);
+void updateObjectBounds(std::vector<Primitive> &sceneObjects, CollisionWorld &collisionWorld);
+void processInput(GLFWwindow* window, const CollisionWorld &collisionWorld);
 unsigned int loadTexture(char const* path);
 
 // settings
@@ -37,6 +50,33 @@ const unsigned int SCR_HEIGHT = 900;
 
 const unsigned int SHADOW_WIDTH = 1600;
 const unsigned int SHADOW_HEIGHT = 900;
+// false skips the shadow pass, the objects then get the lighting permutations without shadows
+const bool SHADOWS_ENABLED = true;
+// coarse front to back layers the color pass is sorted by ahead of its state, see RenderQueue.
+// The opaque pass sorts by state alone, more layers split its state runs and instanced
+// batches once per layer, and the fine depth bits already order each run front to back.
+const unsigned int COLOR_DEPTH_LAYERS = 1;
+// clicking selects the object under the crosshair and outlines its box. Keeps every
+// object's triangles on the CPU, which the collision narrow phase also uses for circles
+// and distorted shapes, false drops them after the upload and tests the boxes instead.
+const bool PICKING_ENABLED = true;
+const glm::vec3 PICKED_COLOR = glm::vec3(1.0f, 0.8f, 0.0f);
+
+// scene object selected by the last click, -1 for none
+int pickedObject = -1;
+
+// size of the window's framebuffer, which the color pass covers
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+
+// transforms of the scene objects, indexed by Primitive::transformId
+TransformStore transforms;
+
+// world bounds of the scene objects, indexed like the transforms, and the hierarchy
+// both render passes are culled against
+std::vector<AABB> worldBounds;
+std::vector<unsigned char> dynamicObjects;
+SceneHierarchy sceneHierarchy;
 
 // camera
 Camera camera(glm::vec3(-10.0f, -10.0f, 10.0f));
@@ -67,6 +107,7 @@ int main() {
         return -1;
     }
     glfwMakeContextCurrent(window);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
 
@@ -76,11 +117,22 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
-    glEnable(GL_DEPTH_TEST);
+    Shader::enableParallelCompile((GLADloadproc)glfwGetProcAddress);
+
+    // Every program is submitted at once, the driver compiles them while the scene is built
+    ThreadPool threadPool;
+    std::vector<Shader> programs = ShaderLoader::load({
+        { "../shaders/normalVertexShader.vs", "../shaders/normalFragmentShader.fs", "../shaders/normalGeometryShader.gs" },
+        { "../shaders/simpleDepthShader.vs", "../shaders/simpleDepthShader.fs" },
+        { "../shaders/highlight.vs", "../shaders/highlight.fs" }
+    }, threadPool);
+    // The lighting program is compiled per permutation, once the objects have picked theirs
+    ShaderVariants lightingVariants(threadPool, "../shaders/simpleVertexShader.vs", "../shaders/lightingFragmentShader.fs");
+    GLState::setEnabled(GL_DEPTH_TEST, true);
 
     // Face culling 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
+    GLState::setEnabled(GL_CULL_FACE, true);
+    GLState::cullFace(GL_BACK);
     glFrontFace(GL_CCW);
 
     // Scene objects
@@ -89,7 +141,30 @@ int main() {
     DirectionalLight dirLight;
     std::vector<unsigned int> textureStorage;
 
-    buildScene(sceneObjects, pointLights, dirLight, textureStorage);
+    // Triangles stay on the CPU so that ray casts hit the actual surfaces
+    Primitive::keepCPUGeometry = PICKING_ENABLED;
+    buildScene(sceneObjects, pointLights, dirLight, textureStorage, lightingVariants, programs[0]);
+
+    // Objects are added in scene order, so transform ids equal object indices
+    for (int i = 0; i < sceneObjects.size(); i++) {
+        sceneObjects[i].transformId = transforms.add(sceneObjects[i].translation, sceneObjects[i].rotation, sceneObjects[i].scale);
+    }
+    worldBounds.resize(sceneObjects.size());
+    for (int i = 0; i < sceneObjects.size(); i++) {
+        dynamicObjects.push_back(sceneObjects[i].dynamic);
+    }
+
+    // Broadphase for the camera's collisions, filled before the first input is handled
+    CollisionWorld collisionWorld(sceneObjects, transforms);
+    collisionWorld.exactNarrowPhase = true;
+    transforms.update();
+    updateObjectBounds(sceneObjects, collisionWorld);
+
+    // Geometry memory per mesh, shared meshes are only resident once
+    for (int i = 0; i < sceneObjects.size(); i++) {
+        sceneObjects[i].printMemoryUsage("Object " + std::to_string(i));
+    }
+    GeometryCache::printStats();
 
     // Generate FrameBufferObject and depthMap for directional light 
     // in order to generate direct light's hard shadows.
@@ -98,7 +173,7 @@ int main() {
 
     unsigned int depthMap;
     glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
+    GLState::bindTexture(0, depthMap);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 
                 SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -106,13 +181,23 @@ int main() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);  
 
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+    GLState::bindFramebuffer(depthMapFBO);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::bindFramebuffer(0);
+
+    Shader simpleDepthShader = programs[1];
+    Shader highlightShader = programs[2];
+    ProgramBinaryCache::printStats();
+
+    // Camera and light uniform blocks, shared by every program
+    FrameUniforms frameUniforms;
 
-    Shader simpleDepthShader("../shaders/simpleDepthShader.vs", "../shaders/simpleDepthShader.fs");
+    // Objects left after culling, for the color pass and the shadow pass
+    std::vector<unsigned int> cameraVisible, lightVisible;
+    // Draws of both passes, sorted by state and depth every frame
+    RenderQueue renderQueue;
 
     // FPS variables
     double prevTime = 0.0f;
@@ -128,8 +213,17 @@ int main() {
         if (timeDiff >= 10.0 / 30.0) {
             std::string FPS = std::to_string((1.0 / timeDiff) * counter);
             std::string ms = std::to_string((timeDiff / counter) * 1000);
-            std::string newTitle = "Basic project - " + FPS + "FPS / " + ms + "ms";
+            std::string culled = std::to_string(sceneObjects.size() - cameraVisible.size());
+            std::string shadowCulled = std::to_string(sceneObjects.size() - lightVisible.size());
+            std::string newTitle = "Basic project - " + FPS + "FPS / " + ms + "ms / " +
+                std::to_string(cameraVisible.size()) + " visible, " + culled + " culled / shadow " +
+                std::to_string(lightVisible.size()) + " visible, " + shadowCulled + " culled / " +
+                std::to_string((int)(collisionWorld.separatingAxisCache().stats().hitRate() * 100.0f)) + "% SAT cache hits / " +
+                std::to_string(GLState::lastFrame().issued) + " GL calls, " + std::to_string(GLState::lastFrame().elided) + " elided / " +
+                std::to_string(renderQueue.stats(PASS_SHADOW).changes() + renderQueue.stats(PASS_COLOR).changes()) + " state changes (" +
+                std::to_string(renderQueue.unsorted(PASS_SHADOW).changes() + renderQueue.unsorted(PASS_COLOR).changes()) + " unsorted)";
             glfwSetWindowTitle(window, newTitle.c_str());
+            collisionWorld.resetSeparatingAxisStats();
             prevTime = crntTime;
             counter = 0;
         }
@@ -138,9 +232,10 @@ int main() {
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
-        processInput(window, sceneObjects);
+        processInput(window, collisionWorld);
 
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        float cameraFarPlane = 100.0f;
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, cameraFarPlane);
         glm::mat4 view = camera.GetViewMatrix();
 
         glm::mat4 lightProjection, lightView;
@@ -154,11 +249,38 @@ int main() {
 
         lightSpaceMatrix = lightProjection * lightView;
 
-        glCullFace(GL_FRONT);
-        // Calcualte depthMap texture
-        buildShadowMap(sceneObjects, lightSpaceMatrix, simpleDepthShader, depthMapFBO);
-        
-        glCullFace(GL_BACK);
+        frameUniforms.update(projection, view, camera.Position, lightSpaceMatrix, dirLight, pointLights);
+
+        // Matrices of moved objects, the collision boxes and world bounds follow them
+        transforms.update();
+        updateObjectBounds(sceneObjects, collisionWorld);
+
+        // Cull against the camera for the color pass and against the light's box for the
+        // shadow pass, objects behind the camera can still cast visible shadows
+        cameraVisible.clear();
+        sceneHierarchy.query(Frustum(projection * view), worldBounds, cameraVisible);
+        lightVisible.clear();
+        sceneHierarchy.query(Frustum(lightSpaceMatrix), worldBounds, lightVisible);
+
+        // Both passes go into one queue, which is sorted once and then submitted pass by pass
+        renderQueue.clear();
+        if (SHADOWS_ENABLED) {
+            queuePass(renderQueue, PASS_SHADOW, sceneObjects, lightVisible, lightPos, glm::normalize(lightDir), far_plane);
+        }
+        queuePass(renderQueue, PASS_COLOR, sceneObjects, cameraVisible, camera.Position, camera.Front, cameraFarPlane);
+        renderQueue.sort();
+
+        if (SHADOWS_ENABLED) {
+            GLState::cullFace(GL_FRONT);
+            // Calcualte depthMap texture
+            buildShadowMap(sceneObjects, renderQueue, simpleDepthShader, depthMapFBO);
+
+            GLState::cullFace(GL_BACK);
+        }
+
+        // the color pass draws to the window
+        GLState::bindFramebuffer(0);
+        GLState::viewport(0, 0, framebufferWidth, framebufferHeight);
 
         // color buffer and depth buffer
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -166,28 +288,28 @@ int main() {
 
         // renderDebugQuad(depthMap);
 
-        renderScene(sceneObjects, pointLights, dirLight, lightSpaceMatrix, depthMap);
+        renderScene(sceneObjects, renderQueue, depthMap, highlightShader);
 
         // swap buffers, do events
         glfwSwapBuffers(window);
         glfwPollEvents();
+        GLState::endFrame();
     }
     
-    for (int i = 0; i < sceneObjects.size(); i++) {
-        glDeleteVertexArrays(1, &sceneObjects[i].VAO);
-        glDeleteBuffers(1, &sceneObjects[i].VBO);
-    }
+    // the last references to the cached meshes delete them, which needs the context
+    sceneObjects.clear();
+    frameUniforms.release();
 
     glfwTerminate();
     return 0;
 }
 
-void buildScene(std::vector<Primitive> &sceneObjects, std::vector<PointLight> &pointLights, DirectionalLight &dirLight, std::vector<unsigned int> &textureStorage) {
+// lightingVariants lights the objects, normalShader displays their normals
+void buildScene(std::vector<Primitive> &sceneObjects, std::vector<PointLight> &pointLights, DirectionalLight &dirLight, std::vector<unsigned int> &textureStorage,
+    ShaderVariants &lightingVariants, const Shader &normalShader) {
 
-    // Shader programs
-    Shader lightingShader("../shaders/simpleVertexShader.vs", "../shaders/lightingFragmentShader.fs");
-    // shader to display the normals
-    Shader normalShader("../shaders/normalVertexShader.vs", "../shaders/normalFragmentShader.fs", "../shaders/normalGeometryShader.gs");
+    // Placeholder until the objects pick their lighting permutation at the end
+    const Shader lightingShader;
 
     textureStorage.push_back(loadTexture("../textures/container2.png"));
     textureStorage.push_back(loadTexture("../textures/container2_specular.png"));
@@ -282,108 +404,157 @@ void buildScene(std::vector<Primitive> &sceneObjects, std::vector<PointLight> &p
 
     PointLight p1(1, glm::vec3(1), glm::vec3(7, 5, 0), glm::vec3(0.05f, 0.05f, 0.05f), glm::vec3(0.8f, 0.8f, 0.8f), glm::vec3(1.0f, 1.0f, 1.0f), 1.0f, 0.09f, 0.032f);
     pointLights.push_back(p1);
+
+    // With the lights known every object picks its lighting permutation, objects that
+    // need the same one share its program. The permutations are built in one batch first.
+    ShaderDefines sceneDefines;
+    sceneDefines.set("NR_POINT_LIGHTS", (int)std::min(pointLights.size(), (size_t)MAX_POINT_LIGHTS));
+    sceneDefines.set("SHADOWS", SHADOWS_ENABLED);
+    std::vector<ShaderDefines> permutations;
+    for (const Primitive &object : sceneObjects) {
+        permutations.push_back(object.variantDefines(sceneDefines));
+    }
+    lightingVariants.prepare(permutations);
+    for (Primitive &object : sceneObjects) {
+        object.selectShaderVariant(lightingVariants, sceneDefines);
+    }
+    lightingVariants.printStats();
 }
 
-void buildShadowMap(std::vector<Primitive> &sceneObjects, glm::mat4 lightSpaceMatrix, Shader depthShader, unsigned int &depthMapFBO) {
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT); 
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+// Sort keys of the visible objects for one pass. Depth is measured from eye along forward,
+// so the closest objects come first within their state.
+void queuePass(RenderQueue &queue, RenderPass pass, const std::vector<Primitive> &sceneObjects, const std::vector<unsigned int> &visible,
+    const glm::vec3 &eye, const glm::vec3 &forward, float farPlane) {
+    for (unsigned int i : visible) {
+        const Primitive& object = sceneObjects[i];
+        float depth = glm::dot(worldBounds[i].center() - eye, forward) / farPlane;
+        unsigned int mesh = queue.meshId(object.mesh.VAO);
+
+        uint64_t key;
+        if (pass == PASS_SHADOW) {
+            // the depth shader draws every object, only the mesh matters
+            key = RenderQueue::key(pass, 0, 0, mesh, depth);
+        } else {
+            unsigned int material = queue.materialId(object.diffuseMap != nullptr ? *object.diffuseMap : 0,
+                object.specularMap != nullptr ? *object.specularMap : 0, object.useSolidColor);
+            key = RenderQueue::key(pass, queue.programId(object.shader.ID), material, mesh, depth, COLOR_DEPTH_LAYERS);
+        }
+        queue.push(key, i);
+    }
+}
+
+void buildShadowMap(std::vector<Primitive> &sceneObjects, const RenderQueue &queue, Shader depthShader, unsigned int &depthMapFBO) {
+    static InstancedRenderer renderer;
+
+    GLState::viewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+    GLState::bindFramebuffer(depthMapFBO);
     glClear(GL_DEPTH_BUFFER_BIT); 
 
+    // lightSpaceMatrix comes from the Camera block
     depthShader.use();
-    depthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
 
-    for (int i = 0; i < sceneObjects.size(); i++) {
+    // Only the mesh matters for depth, so every object sharing one is drawn at once.
+    // The models come from the same TransformStore as the color pass, so both agree.
+    renderer.build(sceneObjects, queue.pass(PASS_SHADOW), transforms, false);
+    for (const InstanceBatch& batch : renderer.batches) {
+        renderer.draw(batch, sceneObjects[batch.object].mesh);
+    }
+}
+
+// Per-material uniform handles of a lighting shader program, resolved once instead of per draw.
+// Camera and light data is not among them, it comes from the per-frame uniform blocks.
+struct LightingUniforms {
+    UniformHandle shininess;
+    UniformHandle diffuseMap, specularMap, shadowMap;
 
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::rotate(model, sceneObjects[i].rotation.x, glm::vec3(1, 0, 0));
-        model = glm::rotate(model, sceneObjects[i].rotation.y, glm::vec3(0, 1, 0));
-        model = glm::rotate(model, sceneObjects[i].rotation.z, glm::vec3(0, 0, 1));
-        model = glm::translate(model, sceneObjects[i].translation);
-        model = glm::scale(model, sceneObjects[i].scale);
+    LightingUniforms() {}
 
-        depthShader.setMat4("model", model);
+    // Only the uniforms the program's permutation declares are looked up
+    LightingUniforms(const Shader& shader, bool textured, bool shadows) {
+        shininess = shader.uniform("material.shininess");
 
-        sceneObjects[i].draw();
+        if (textured) {
+            diffuseMap = shader.uniform("material.diffuse");
+            specularMap = shader.uniform("material.specular");
+        }
+        if (shadows) {
+            shadowMap = shader.uniform("shadowMap");
+        }
     }
+};
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
+void renderScene(std::vector<Primitive> &sceneObjects, const RenderQueue &queue, unsigned int &depthMap, Shader highlightShader) {
+    static InstancedRenderer renderer;
+    static std::unordered_map<unsigned int, LightingUniforms> shaderUniforms;
 
-void renderScene(std::vector<Primitive> &sceneObjects, std::vector<PointLight> &pointLights, DirectionalLight dirLight, glm::mat4 lightSpaceMatrix, unsigned int &depthMap) {
     // Render objects
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    glm::mat4 view = camera.GetViewMatrix();
+    // Objects sharing mesh, shader and textures are drawn with one instanced call,
+    // their matrices and solid colors come from the instance buffer
+    std::pair<const RenderItem*, const RenderItem*> items = queue.pass(PASS_COLOR);
+    renderer.build(sceneObjects, items, transforms, true);
+
+    for (const InstanceBatch& batch : renderer.batches) {
+        Primitive& object = sceneObjects[batch.object];
+
+        Shader& shader = object.shader;
+        // the permutation the object picked, see Primitive::selectShaderVariant
+        bool textured = !object.useSolidColor;
+        bool shadows = SHADOWS_ENABLED && object.receiveShadows;
+
+        auto found = shaderUniforms.find(shader.ID);
+        if (found == shaderUniforms.end()) {
+            found = shaderUniforms.emplace(shader.ID, LightingUniforms(shader, textured, shadows)).first;
+        }
+        const LightingUniforms& u = found->second;
 
-    for (int i = 0; i < sceneObjects.size(); i++) {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, sceneObjects[i].translation);
-        model = glm::scale(model, sceneObjects[i].scale);
-        model = glm::rotate(model, sceneObjects[i].rotation.x, glm::vec3(1, 0, 0));
-        model = glm::rotate(model, sceneObjects[i].rotation.y, glm::vec3(0, 1, 0));
-        model = glm::rotate(model, sceneObjects[i].rotation.z, glm::vec3(0, 0, 1));
+        shader.use();
 
-        sceneObjects[i].shader.use();
-        sceneObjects[i].shader.setMat4("projection", projection);
-        sceneObjects[i].shader.setMat4("view", view);
-        sceneObjects[i].shader.setMat4("model", model);
-        sceneObjects[i].shader.setVec3("solidColor", sceneObjects[i].color);
-        sceneObjects[i].shader.setBool("useSolidColor", sceneObjects[i].useSolidColor);
-
-        sceneObjects[i].shader.setVec3("viewPos", camera.Position);
-
-        sceneObjects[i].shader.setFloat("material.shininess", 32.0f);
-
-        sceneObjects[i].shader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-
-        // directional light
-        sceneObjects[i].shader.setVec3("dirLight.direction", dirLight.direction);
-        sceneObjects[i].shader.setVec3("dirLight.ambient", dirLight.ambient);
-        sceneObjects[i].shader.setVec3("dirLight.diffuse", dirLight.diffuse);
-        sceneObjects[i].shader.setVec3("dirLight.specular", dirLight.specular);
-
-        for (size_t j = 0; j < pointLights.size(); ++j) {
-            std::string prefix = "pointLights[" + std::to_string(j) + "].";
-            sceneObjects[i].shader.setVec3(prefix + "position", pointLights[j].position);
-            sceneObjects[i].shader.setVec3(prefix + "ambient", pointLights[j].ambient);
-            sceneObjects[i].shader.setVec3(prefix + "diffuse", pointLights[j].diffuse);
-            sceneObjects[i].shader.setVec3(prefix + "specular", pointLights[j].specular);
-            sceneObjects[i].shader.setFloat(prefix + "constant", pointLights[j].constant);
-            sceneObjects[i].shader.setFloat(prefix + "linear", pointLights[j].linear);
-            sceneObjects[i].shader.setFloat(prefix + "quadratic", pointLights[j].quadratic);
-        }
+        shader.setFloat(u.shininess, 32.0f);
 
-        if (sceneObjects[i].diffuseMap != nullptr && sceneObjects[i].specularMap != nullptr) {
+        if (textured && object.diffuseMap != nullptr && object.specularMap != nullptr) {
             // pass sampler2D indexes
-            sceneObjects[i].shader.setInt("material.diffuse", 0);
-            sceneObjects[i].shader.setInt("material.specular", 1);
+            shader.setInt(u.diffuseMap, 0);
+            shader.setInt(u.specularMap, 1);
 
             // bind diffuse map
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, *sceneObjects[i].diffuseMap);
+            GLState::bindTexture(0, *object.diffuseMap);
             // bind specular map
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, *sceneObjects[i].specularMap);
+            GLState::bindTexture(1, *object.specularMap);
         }
 
         // Shadows
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
-        sceneObjects[i].shader.setInt("shadowMap", 2);
-
-        // Draw object
-        sceneObjects[i].draw();
-        
-        // Draw bb
-        sceneObjects[i].bb.setTransformation(model);
+        if (shadows) {
+            GLState::bindTexture(2, depthMap);
+            shader.setInt(u.shadowMap, 2);
+        }
+
+        // Draw objects
+        renderer.draw(batch, object.mesh);
+    }
+
+    for (const RenderItem* item = items.first; item != items.second; item++) {
+        unsigned int i = item->object;
+        // Draw bb, the lines have no instance arrays so model and color are set as constants
+        sceneObjects[i].shader.use();
+        unsigned int id = sceneObjects[i].transformId;
+        InstancedRenderer::setConstantInstance(transforms.world[id], sceneObjects[i].color, transforms.normal[id]);
         sceneObjects[i].drawBB();
 
         // Draw normals
         // sceneObjects[i].normalsShader.use();
-        // sceneObjects[i].normalsShader.setMat4("projection", projection);
-        // sceneObjects[i].normalsShader.setMat4("view", view);
-        // sceneObjects[i].normalsShader.setMat4("model", model);
+        // sceneObjects[i].normalsShader.setMat4("model", transforms.world[id]);
         // sceneObjects[i].draw();
     }
+
+    // The picked object's box is drawn over everything, even when it is culled
+    if (pickedObject >= 0) {
+        GLState::setEnabled(GL_DEPTH_TEST, false);
+        highlightShader.use();
+        unsigned int id = sceneObjects[pickedObject].transformId;
+        InstancedRenderer::setConstantInstance(transforms.world[id], PICKED_COLOR, transforms.normal[id]);
+        sceneObjects[pickedObject].drawBB();
+        GLState::setEnabled(GL_DEPTH_TEST, true);
+    }
 }
 
 void renderDebugQuad(unsigned int depthMap) {
@@ -397,8 +568,8 @@ void renderDebugQuad(unsigned int depthMap) {
         };
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        GLState::bindVertexArray(quadVAO);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
@@ -407,30 +578,55 @@ void renderDebugQuad(unsigned int depthMap) {
     }
     static Shader debugShader("../shaders/debugQuad.vs", "../shaders/debugQuad.fs");
     debugShader.use();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
+    GLState::bindTexture(0, depthMap);
     debugShader.setInt("depthMap", 0);
-    glBindVertexArray(quadVAO);
+    GLState::bindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-    glBindVertexArray(0);
 }
 
-void processInput(GLFWwindow* window, std::vector<Primitive> objects) {
+// Moves the collision boxes, world bounds, culling hierarchy and collision broadphase
+// of the objects whose matrices the last transforms.update() rebuilt
+void updateObjectBounds(std::vector<Primitive> &sceneObjects, CollisionWorld &collisionWorld) {
+    for (unsigned int id : transforms.changed) {
+        Primitive& object = sceneObjects[id];
+        object.bb = object.localBB.transformed(transforms.world[id]);
+        worldBounds[id] = object.bb.bounds();
+    }
+    // static objects are baked on the first call, later calls only refit the moving ones
+    if (sceneHierarchy.size() != worldBounds.size()) {
+        sceneHierarchy.build(worldBounds, dynamicObjects);
+    } else {
+        sceneHierarchy.update(worldBounds, transforms.changed);
+    }
+    collisionWorld.update(worldBounds, transforms.changed);
+}
+
+void processInput(GLFWwindow* window, const CollisionWorld &collisionWorld) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, deltaTime, objects);
+        camera.ProcessKeyboard(FORWARD, deltaTime, collisionWorld);
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, deltaTime, objects);
+        camera.ProcessKeyboard(BACKWARD, deltaTime, collisionWorld);
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, deltaTime, objects);
+        camera.ProcessKeyboard(LEFT, deltaTime, collisionWorld);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, deltaTime, objects);
+        camera.ProcessKeyboard(RIGHT, deltaTime, collisionWorld);
+
+    // Pick the object under the crosshair once per click, clicking at nothing deselects
+    static bool wasPressed = false;
+    bool pressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    if (PICKING_ENABLED && pressed && !wasPressed) {
+        pickedObject = collisionWorld.raycast(camera.Position, camera.Front, 100.0f).object;
+    }
+    wasPressed = pressed;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
+    // applied by the next color pass
+    framebufferWidth = width;
+    framebufferHeight = height;
 }
 
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
@@ -467,7 +663,7 @@ unsigned int loadTexture(char const* path) {
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLState::bindTexture(0, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 